@@ -0,0 +1,238 @@
+#!/bin/sh
+# Strong/weak scaling driver for game_of_life: sweeps process counts, board
+# sizes and iteration counts with warmup and repeated runs, and writes one
+# CSV row per configuration with speedup, parallel efficiency and, for
+# strong scaling, the Karp-Flatt serial fraction
+#
+# usage: ./bench_GOL.sh [--mode=strong|weak|both] [--procs="1 2 4 8"] [--sizes="1024 2048"]
+#                       [--iterations="100"] [--reps=3] [--warmup=1] [--seed=S]
+#                       [--launcher=mpirun] [--launcher-flags="..."] [--out=scaling.csv]
+#                       [--baseline=old_scaling.csv] [--tolerance=10] [--no-build] [-- game_of_life flags]
+#
+# strong: every board size is run at every process count
+# weak:   each size is the board at the smallest process count; the board side
+#         grows with sqrt(procs) so every proc keeps the same number of cells
+#
+# Runs use plain mpirun by default; inside a SLURM allocation pass --launcher=srun.
+# Every run is kept in <out>_runs.csv; <out> holds the median of each configuration.
+# With --baseline, configurations more than --tolerance percent slower than the
+# baseline file are listed and the script exits with status 2.
+
+MODE=both
+PROCS="1 2 4"
+SIZES="512"
+ITERATIONS="100"
+REPS=3
+WARMUP=1
+SEED=1
+LAUNCHER=mpirun
+LAUNCHER_FLAGS=""
+OUT=scaling.csv
+BASELINE=""
+TOLERANCE=10
+BUILD=1
+
+usage()
+{
+    sed -n '7,10p' "$0" >&2
+    exit 1
+}
+
+while [ $# -gt 0 ]
+do
+    case "$1" in
+        --mode=*) MODE="${1#*=}" ;;
+        --procs=*) PROCS="${1#*=}" ;;
+        --sizes=*) SIZES="${1#*=}" ;;
+        --iterations=*) ITERATIONS="${1#*=}" ;;
+        --reps=*) REPS="${1#*=}" ;;
+        --warmup=*) WARMUP="${1#*=}" ;;
+        --seed=*) SEED="${1#*=}" ;;
+        --launcher=*) LAUNCHER="${1#*=}" ;;
+        --launcher-flags=*) LAUNCHER_FLAGS="${1#*=}" ;;
+        --out=*) OUT="${1#*=}" ;;
+        --baseline=*) BASELINE="${1#*=}" ;;
+        --tolerance=*) TOLERANCE="${1#*=}" ;;
+        --no-build) BUILD=0 ;;
+        --) shift; break ;;
+        *) usage ;;
+    esac
+    shift
+done
+# everything after -- goes to every game_of_life run
+GOL_FLAGS="$*"
+
+case "$MODE" in
+    strong) MODES="strong" ;;
+    weak) MODES="weak" ;;
+    both) MODES="strong weak" ;;
+    *) usage ;;
+esac
+
+# the baseline of each series is its smallest process count
+PROCS=$(echo $PROCS | tr ' ' '\n' | sort -n | tr '\n' ' ')
+P0=$(echo $PROCS | cut -d' ' -f1)
+
+case "$LAUNCHER" in
+    *srun) NP_FLAG=-n ;;
+    *) NP_FLAG=-np ;;
+esac
+
+if [ $BUILD -eq 1 ]
+then
+    mpicc -O2 -fopenmp -o game_of_life game_of_life.c gol_*.c -lm || exit 1
+fi
+
+RUNS="${OUT%.csv}_runs.csv"
+rm -f "$RUNS"
+
+# run_once <procs> <iterations> <board_size>: the metrics header and row of one run
+run_once()
+{
+    $LAUNCHER $LAUNCHER_FLAGS $NP_FLAG "$1" ./game_of_life "$2" "$3" --metrics=csv --seed=$SEED $GOL_FLAGS |
+        awk '/^num_procs,/ { print; getline; print; exit }'
+}
+
+for mode in $MODES
+do
+    for size in $SIZES
+    do
+        for iterations in $ITERATIONS
+        do
+            for p in $PROCS
+            do
+                board=$size
+                if [ "$mode" = "weak" ]
+                then
+                    board=$(awk -v s=$size -v p=$p -v p0=$P0 'BEGIN { printf "%d", s*sqrt(p/p0) + 0.5 }')
+                fi
+
+                # warmup runs fault in pages and caches and are not recorded
+                w=0
+                while [ $w -lt $WARMUP ]
+                do
+                    run_once $p $iterations $board > /dev/null
+                    w=$((w + 1))
+                done
+
+                r=0
+                while [ $r -lt $REPS ]
+                do
+                    result=$(run_once $p $iterations $board)
+                    if [ -z "$result" ]
+                    then
+                        echo "run failed: $mode procs=$p board=$board iterations=$iterations" >&2
+                        exit 1
+                    fi
+                    if [ ! -f "$RUNS" ]
+                    then
+                        echo "mode,series_size,rep,$(echo "$result" | sed -n 1p)" > "$RUNS"
+                    fi
+                    echo "$mode,$size,$r,$(echo "$result" | sed -n 2p)" >> "$RUNS"
+                    echo "$mode procs=$p board=$board iterations=$iterations rep=$r done" >&2
+                    r=$((r + 1))
+                done
+            done
+        done
+    done
+done
+
+# median over the reps of every configuration, then speedup against the series' smallest run:
+#   strong: S = p0*T(p0)/T(p)    weak (scaled): S = p*T(p0)/T(p)
+#   efficiency E = S/p           Karp-Flatt e = (1/S - 1/p)/(1 - 1/p), strong only:
+#   it assumes a fixed problem, so weak rows leave it empty
+awk -F, -v baseline="$BASELINE" -v tolerance="$TOLERANCE" '
+function median(list,    n, v, i, j, t)
+{
+    n = split(list, v, " ")
+    for (i = 2; i <= n; i++)
+    {
+        for (j = i; j > 1 && v[j-1] + 0 > v[j] + 0; j--)
+        {
+            t = v[j]; v[j] = v[j-1]; v[j-1] = t
+        }
+    }
+    return n % 2 ? v[(n+1)/2] : (v[n/2] + v[n/2+1])/2
+}
+BEGIN {
+    if (baseline != "")
+    {
+        while ((getline line < baseline) > 0)
+        {
+            split(line, f, ",")
+            if (f[1] != "mode")
+            {
+                base[f[1] "," f[2] "," f[3] "," f[4]] = f[6]
+            }
+        }
+    }
+}
+FNR == 1 {
+    for (i = 1; i <= NF; i++)
+    {
+        col[$i] = i
+    }
+    next
+}
+{
+    key = $1 "," $col["num_procs"] "," $col["board_size"] "," $col["num_iterations"]
+    series = $1 "," $2 "," $col["num_iterations"]
+    if (!(key in runtimes))
+    {
+        order[++count] = key
+        series_of[key] = series
+        procs_of[key] = $col["num_procs"]
+    }
+    runtimes[key] = runtimes[key] " " $col["total_runtime_us"]
+    comm[key] = comm[key] " " $col["comm_time_us"]
+    cells[key] = cells[key] " " $col["cells_per_second"]
+    imbalance[key] = imbalance[key] " " $col["load_imbalance"]
+    runs[key]++
+    t = $col["total_runtime_us"] + 0
+    if (!(key in fastest) || t < fastest[key]) fastest[key] = t
+    if (!(key in slowest) || t > slowest[key]) slowest[key] = t
+    if (!(series in first_procs) || $col["num_procs"] + 0 < first_procs[series])
+    {
+        first_procs[series] = $col["num_procs"] + 0
+        first_key[series] = key
+    }
+}
+END {
+    print "mode,procs,board_size,num_iterations,runs,runtime_us,runtime_min_us,runtime_max_us,comm_time_us," \
+          "cells_per_second,load_imbalance,speedup,efficiency,karp_flatt,baseline_runtime_us,change_pct"
+    regressions = 0
+    for (k = 1; k <= count; k++)
+    {
+        key = order[k]
+        split(key, f, ",")
+        p = procs_of[key] + 0
+        p0 = first_procs[series_of[key]]
+        t = median(runtimes[key])
+        t0 = median(runtimes[first_key[series_of[key]]])
+        speedup = t > 0 ? (f[1] == "weak" ? p : p0)*t0/t : 0
+        efficiency = speedup/p
+        karp_flatt = (f[1] == "strong" && p > 1 && speedup > 0) ? sprintf("%.4f", (1/speedup - 1/p)/(1 - 1/p)) : ""
+
+        before = ""; change = ""
+        if (key in base && base[key] > 0)
+        {
+            before = base[key]
+            change = sprintf("%.2f", 100*(t - before)/before)
+            if (change + 0 > tolerance + 0)
+            {
+                printf "regression: %s procs=%d board=%d iterations=%d %.3f us -> %.3f us (+%s%%)\n",
+                       f[1], p, f[3], f[4], before, t, change > "/dev/stderr"
+                regressions++
+            }
+        }
+
+        printf "%s,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.6e,%.4f,%.4f,%.4f,%s,%s,%s\n",
+               f[1], p, f[3], f[4], runs[key], t, fastest[key], slowest[key], median(comm[key]),
+               median(cells[key]), median(imbalance[key]), speedup, efficiency, karp_flatt, before, change
+    }
+    exit regressions > 0 ? 2 : 0
+}' "$RUNS" > "$OUT"
+status=$?
+
+echo "wrote $OUT (medians) and $RUNS (every run)" >&2
+exit $status
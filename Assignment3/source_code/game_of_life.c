@@ -9,8 +9,11 @@
 #include <string.h>
 
 #include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-#define __DEBUG__ 0
+#include "gol.h"
 
 // Globals for time keeping
 double total_runtime = 0.0;
@@ -21,37 +24,70 @@ double total_comm_time = 0.0;
 int HEIGHT = 0;
 int WIDTH = 0;
 
-void GenerateInitialGOL(int partial_board[][WIDTH], int rank, int p)
-{   
-    // give each process a random seed (except p0, which uses system time)
-    // record the communication time
-    double comm_start = MPI_Wtime();
-    if (rank == 0)
+// Globals for memory/traffic metrics
+double board_bytes_per_proc = 0.0;
+double halo_bytes_per_generation = 0.0;
+double overlap_window_time = 0.0;
+int GENERATION_BARRIER = 0;
+double sweep_bytes_per_generation = 0.0;
+double temporal_bytes_per_generation = 0.0;
+double temporal_working_set = 0.0;
+const char* halo_transport_name = "msg";
+double halo_shared_fraction = 0.0;
+double halo_exchanges = 0.0;
+double halo_messages = 0.0;
+double halo_shared_edges = 0.0;
+double owned_cell_updates = 0.0;
+double redundant_cell_updates = 0.0;
+const char* kernel_name = "scalar";
+const char* rule_kernel = "table";
+double hashlife_population = 0.0;
+double hashlife_peak_nodes = 0.0;
+double hashlife_bytes = 0.0;
+double hashlife_hit_rate = 0.0;
+int hashlife_collections = 0;
+double tile_update_fraction = 0.0;
+double halo_edge_skip_fraction = 0.0;
+double snapshot_bytes = 0.0;
+double snapshot_time = 0.0;
+int snapshot_count = 0;
+int balance_checks = 0;
+int balance_rebalances = 0;
+double balance_rows_moved = 0.0;
+double balance_time = 0.0;
+double balance_imbalance = 1.0;
+char balance_layout[256] = "";
+double ooc_file_bytes = 0.0;
+
+// seed of the initial board (see InitialWord)
+uint64_t SEED = 0;
+
+// cells [j0, j0 + n) of global row i of the initial board, one hash per 64 cells
+void InitialRow(int i, int j0, int n, uint8_t* out)
+{
+    int j = 0;
+    while (j < n)
     {
-        srand(time(NULL));
-        for (int i = 1; i < p; i++)
+        int col = j0 + j;
+        uint64_t word = InitialWord(i, col >> 6) >> (col & 63);
+        int run = 64 - (col & 63);
+        run = run < n - j ? run : n - j;
+        for (int k = 0; k < run; k++)
         {
-            int seed = rand() % (217645199) + 1;
-            MPI_Send(&seed, 1, MPI_INT, i, 0, MPI_COMM_WORLD);
+            out[j + k] = (word >> k) & 1;
         }
+        j += run;
     }
-    else
-    {
-        int recv_seed = 0;
-        MPI_Recv(&recv_seed, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        srand(recv_seed);
-    }
-
-    // stop recording comm time
-    double comm_end = MPI_Wtime();
-    total_comm_time += comm_end - comm_start;
+}
 
-    // generate random values to determine cell state
+void GenerateInitialGOL(int partial_board[][WIDTH], int rank, int p)
+{
+    // each cell is a hash of the seed and its global coordinates
     for (int i = 0; i < (HEIGHT/p); i++)
     {
         for (int j = 0; j < WIDTH; j++)
         {
-            partial_board[i][j] = rand() % 2;
+            partial_board[i][j] = InitialCell(rank*(HEIGHT/p) + i, j);
         }
     }
     if (__DEBUG__)
@@ -80,9 +116,10 @@ void PrintBoard(int board[][WIDTH], int rank, int p)
         }
 
         // p0 receives and prints the boards of the other procs
+        GolBlock recv_block;
+        int (*recv_board)[WIDTH] = GolAlloc(&recv_block, sizeof(int)*(HEIGHT/p)*WIDTH);
         for (int i = 1; i < p; i++)
         {
-            int recv_board[(HEIGHT/p)][WIDTH];
             MPI_Recv(recv_board, (HEIGHT/p)*WIDTH, MPI_INT, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
             for (int j = 0; j < (HEIGHT/p); j++)
             {
@@ -94,6 +131,7 @@ void PrintBoard(int board[][WIDTH], int rank, int p)
             }
         }
         printf("\n");
+        GolFree(&recv_block);
     }
 }
 
@@ -114,7 +152,7 @@ int DetermineState(int x, int y, int partial_board[][WIDTH], int top_row[WIDTH],
     }
     else
     {
-        neighbor_sum += partial_board[x-1][y-1];
+        neighbor_sum += partial_board[x-1][(y+WIDTH-1)%WIDTH];
     }
 
     // ADD SECOND NEIGHBOR: TOP MIDDLE
@@ -139,7 +177,7 @@ int DetermineState(int x, int y, int partial_board[][WIDTH], int top_row[WIDTH],
     }
     else
     {
-        neighbor_sum += partial_board[x-1][y+1];
+        neighbor_sum += partial_board[x-1][(y+1)%WIDTH];
     }
 
     // ADD FOURTH NEIGHBOR: LEFT MIDDLE
@@ -174,7 +212,7 @@ int DetermineState(int x, int y, int partial_board[][WIDTH], int top_row[WIDTH],
     }
     else
     {
-        neighbor_sum += partial_board[x+1][y-1];
+        neighbor_sum += partial_board[x+1][(y+WIDTH-1)%WIDTH];
     }
 
     // ADD SEVENTH NEIGHBOR: BOTTOM MIDDLE
@@ -199,31 +237,51 @@ int DetermineState(int x, int y, int partial_board[][WIDTH], int top_row[WIDTH],
     }
     else
     {
-        neighbor_sum += partial_board[x+1][y+1];
+        neighbor_sum += partial_board[x+1][(y+1)%WIDTH];
     }
    
-    // determine next state
-    if (neighbor_sum > 2 && neighbor_sum < 6)
-    {
-        return 1;
-    }
-
-    return 0;
+    // determine next state from the rule table
+    return RULE_TABLE[partial_board[x][y]][neighbor_sum];
 }
 
 void Simulate(int partial_board[][WIDTH], int rank, int p, int num_iterations)
 {
     // each iteration, send the top and bottom rows to the appropriate proc
-    int top_row[WIDTH];
-    int bottom_row[WIDTH];
-    int my_top_row[WIDTH];
-    int my_bottom_row[WIDTH];
-    
+    GolBlock rows_block;
+    int* top_row = GolAlloc(&rows_block, 4*sizeof(int)*WIDTH);
+    int* bottom_row = top_row + WIDTH;
+    int* my_top_row = bottom_row + WIDTH;
+    int* my_bottom_row = my_top_row + WIDTH;
+
+    /*
+    * The rows always go to the same two neighbors (p0 and p-1 wrap around
+    * the torus) from the same buffers, so the four transfers are set up
+    * once as persistent requests and only restarted each iteration:
+    * our bottom row comes from the proc below tagged 1, our top row from
+    * the proc above tagged 2
+    */
+    int up = (rank + p - 1) % p;
+    int down = (rank + 1) % p;
+    MPI_Request requests[4];
+    if (p != 1)
+    {
+        MPI_Recv_init(bottom_row, WIDTH, MPI_INT, down, 1, MPI_COMM_WORLD, &requests[0]);
+        MPI_Recv_init(top_row, WIDTH, MPI_INT, up, 2, MPI_COMM_WORLD, &requests[1]);
+        MPI_Send_init(my_top_row, WIDTH, MPI_INT, up, 1, MPI_COMM_WORLD, &requests[2]);
+        MPI_Send_init(my_bottom_row, WIDTH, MPI_INT, down, 2, MPI_COMM_WORLD, &requests[3]);
+    }
+
     for (int i = 0; i < num_iterations; i++)
     {
         //printf("rank: %d, iteration: %d\n", rank, i);
-        // MPI_Barrier to synchronize all procs
-        MPI_Barrier(MPI_COMM_WORLD);
+        // neighbors already wait on each other's rows; a global barrier is opt-in
+        TimingBeginGeneration();
+        if (GENERATION_BARRIER)
+        {
+            double barrier_start = MPI_Wtime();
+            MPI_Barrier(MPI_COMM_WORLD);
+            TimingAdd(TIMER_BARRIER, MPI_Wtime() - barrier_start);
+        }
 
         if (__DEBUG__)
         {
@@ -239,6 +297,7 @@ void Simulate(int partial_board[][WIDTH], int rank, int p, int num_iterations)
             my_top_row[j] = partial_board[0][j];
             my_bottom_row[j] = partial_board[(HEIGHT/p)-1][j];
         }
+        TimingAdd(TIMER_PACK, MPI_Wtime() - start_single_gen_time);
 
         if (__DEBUG__)
         {
@@ -252,105 +311,8 @@ void Simulate(int partial_board[][WIDTH], int rank, int p, int num_iterations)
         double comm_start = MPI_Wtime();
         if (p != 1)
         {
-            if (rank == 0)
-            {
-                // use non blocking communication
-                MPI_Request request1, request2;
-                MPI_Status status1, status2;
-                MPI_Irecv(bottom_row, WIDTH, MPI_INT, rank+1, 1, MPI_COMM_WORLD, &request1);
-                MPI_Irecv(top_row, WIDTH, MPI_INT, p-1, 2, MPI_COMM_WORLD, &request2);
-
-                // p0 top row is p-1 bottom row
-                MPI_Send(my_top_row, WIDTH, MPI_INT, p-1, 1, MPI_COMM_WORLD);
-
-                MPI_Send(my_bottom_row, WIDTH, MPI_INT, rank+1, 2, MPI_COMM_WORLD);
-
-                MPI_Wait(&request1, &status1);
-                MPI_Wait(&request2, &status2);
-
-                /*
-                if (__DEBUG__)
-                {
-                    printf("Process %d has sent top and bottom rows\n", rank);
-                }
-
-                // p-1 bottom row is p0 top row
-                MPI_Recv(top_row, WIDTH, MPI_INT, p-1, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-                MPI_Recv(bottom_row, WIDTH, MPI_INT, rank+1, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-                if (__DEBUG__)
-                {
-                    printf("Process %d has received top and bottom rows\n", rank);
-                }
-                */
-            }
-            else if (rank == p-1)
-            {
-                // use non blocking communication
-                MPI_Request request1, request2;
-                MPI_Status status1, status2;
-                MPI_Irecv(bottom_row, WIDTH, MPI_INT, 0, 1, MPI_COMM_WORLD, &request1);
-                MPI_Irecv(top_row, WIDTH, MPI_INT, rank-1, 2, MPI_COMM_WORLD, &request2);
-
-                // 0 top row is p-1 bottom row
-                MPI_Send(my_bottom_row, WIDTH, MPI_INT, 0, 2, MPI_COMM_WORLD);
-
-                MPI_Send(my_top_row, WIDTH, MPI_INT, rank-1, 1, MPI_COMM_WORLD);
-
-                MPI_Wait(&request1, &status1);
-                MPI_Wait(&request2, &status2);
-
-                /*
-                if (__DEBUG__)
-                {
-                    printf("Process %d has sent top and bottom rows\n", rank);
-                }
-
-                // 0 top row is p-1 bottom row
-                MPI_Recv(bottom_row, WIDTH, MPI_INT, 0, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-                MPI_Recv(top_row, WIDTH, MPI_INT, rank-1, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-                if (__DEBUG__)
-                {
-                    printf("Process %d has received top and bottom rows\n", rank);
-                }
-                */
-            }
-            else
-            {
-                // use non blocking communication
-                MPI_Request request1, request2;
-                MPI_Status status1, status2;
-                MPI_Irecv(bottom_row, WIDTH, MPI_INT, rank+1, 1, MPI_COMM_WORLD, &request1);
-                MPI_Irecv(top_row, WIDTH, MPI_INT, rank-1, 2, MPI_COMM_WORLD, &request2);
-
-                // send top row to proc above
-                MPI_Send(my_top_row, WIDTH, MPI_INT, rank-1, 1, MPI_COMM_WORLD);
-                // send bottom row to proc below
-                MPI_Send(my_bottom_row, WIDTH, MPI_INT, rank+1, 2, MPI_COMM_WORLD);
-
-                MPI_Wait(&request1, &status1);
-                MPI_Wait(&request2, &status2);
-
-                /*
-                if (__DEBUG__)
-                {
-                    printf("Process %d has sent top and bottom rows\n", rank);
-                }
-
-                // receive bottom row from proc above
-                MPI_Recv(top_row, WIDTH, MPI_INT, rank-1, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                // receive top row from proc below
-                MPI_Recv(bottom_row, WIDTH, MPI_INT, rank+1, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-                if (__DEBUG__)
-                {
-                    printf("Process %d has received top and bottom rows\n", rank);
-                }
-                */
-            }
+            MPI_Startall(4, requests);
+            MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
         }
         // serial case
         else
@@ -372,6 +334,7 @@ void Simulate(int partial_board[][WIDTH], int rank, int p, int num_iterations)
         // end recording communication time
         double comm_end = MPI_Wtime();
         total_comm_time += comm_end - comm_start;
+        TimingAdd(TIMER_WAIT, comm_end - comm_start);
 
         /*
         * Determine new state
@@ -420,8 +383,8 @@ void Simulate(int partial_board[][WIDTH], int rank, int p, int num_iterations)
         */
 
         // end recording time for single_generation metric
-        double end_single_gen_time = MPI_Wtime();
-        double single_gen_time = end_single_gen_time - start_single_gen_time;
+        TimingAdd(TIMER_COMPUTE, MPI_Wtime() - comm_end);
+        TimingEndGeneration();
 
         /*
         if (i % 2 == 0 && __DEBUG__)
@@ -439,12 +402,393 @@ void Simulate(int partial_board[][WIDTH], int rank, int p, int num_iterations)
             printf("Process %d has finished iteration %d\n", rank, i);
        }
     }
+
+    if (p != 1)
+    {
+        for (int r = 0; r < 4; r++)
+        {
+            MPI_Request_free(&requests[r]);
+        }
+    }
+    GolFree(&rows_block);
+}
+
+/*
+* Machine-readable metrics: one JSON object, with the per-proc phase
+* totals, for dashboards to ingest directly
+*/
+static void PrintMetricsJson(const GolOptions* opts, int p, int num_iterations, int board_size, double runtime,
+                             const GolTimingStats* stats, const double* rank_sums)
+{
+    printf("{\"num_procs\": %d, \"num_iterations\": %d, \"board_size\": %d, ", p, num_iterations, board_size);
+    printf("\"engine\": \"%s\", \"rule\": \"%s\", \"seed\": %llu, \"threads\": %d, \"halo_depth\": %d, ",
+           opts->engine, RULE.name, (unsigned long long)SEED, opts->threads, opts->halo_depth);
+    printf("\"total_runtime_us\": %.3lf, \"comm_time_us\": %.3lf, \"generation_time_us\": %.3lf, ",
+           runtime*1000000, total_comm_time*1000000, single_generation_runtime*1000000);
+    printf("\"cells_per_second\": %.6le, \"board_bytes_per_proc\": %.0lf, \"halo_bytes_per_generation\": %.0lf, ",
+           runtime > 0 ? (double)HEIGHT*WIDTH*num_iterations/runtime : 0.0, board_bytes_per_proc, halo_bytes_per_generation);
+    printf("\"halo_transport\": \"%s\", \"halo_shared_fraction\": %.4lf, ", halo_transport_name, halo_shared_fraction);
+    printf("\"ooc_band\": %d, \"ooc_file_bytes\": %.0lf, ", opts->ooc_band, ooc_file_bytes);
+    printf("\"temporal_rows\": %d, \"sweep_bytes_per_generation\": %.0lf, \"temporal_bytes_per_generation\": %.0lf, ",
+           opts->temporal_rows, sweep_bytes_per_generation, temporal_bytes_per_generation);
+    printf("\"steady_generation\": %d, \"steady_period\": %d, \"population\": [", steady_generation, steady_period);
+    for (int g = 0; g < population_generations; g++)
+    {
+        printf("%s%.0lf", g ? ", " : "", population_trajectory[g]);
+    }
+    printf("], ");
+    printf("\"rebalances\": %d, \"rows_migrated\": %.0lf, \"balancing_time_us\": %.3lf, ",
+           balance_rebalances, balance_rows_moved, balance_time*1000000);
+    printf("\"generations_timed\": %.0lf, \"load_imbalance\": %.4lf, \"timers_us\": {", stats->generations, stats->imbalance);
+    for (int t = 0; t < TIMER_COUNT; t++)
+    {
+        printf("%s\"%s\": {\"min\": %.3lf, \"mean\": %.3lf, \"max\": %.3lf, \"p99\": %.3lf}", t ? ", " : "", TIMER_NAMES[t],
+               stats->timers[t].min*1000000, stats->timers[t].mean*1000000,
+               stats->timers[t].max*1000000, stats->timers[t].p99*1000000);
+    }
+    printf("}, \"procs_us\": [");
+    for (int r = 0; r < p; r++)
+    {
+        printf("%s{\"rank\": %d", r ? ", " : "", r);
+        for (int t = 0; t < TIMER_COUNT; t++)
+        {
+            printf(", \"%s\": %.3lf", TIMER_NAMES[t], rank_sums[r*TIMER_COUNT + t]*1000000);
+        }
+        printf("}");
+    }
+    printf("]}\n");
+}
+
+// one header line and one row per run, so repeated runs can be appended to one file
+static void PrintMetricsCsv(const GolOptions* opts, int p, int num_iterations, int board_size, double runtime,
+                            const GolTimingStats* stats)
+{
+    printf("num_procs,num_iterations,board_size,engine,rule,threads,halo_depth,total_runtime_us,comm_time_us,"
+           "generation_time_us,cells_per_second,load_imbalance,steady_generation,steady_period");
+    for (int t = 0; t < TIMER_COUNT; t++)
+    {
+        printf(",%s_min_us,%s_mean_us,%s_max_us,%s_p99_us", TIMER_NAMES[t], TIMER_NAMES[t], TIMER_NAMES[t], TIMER_NAMES[t]);
+    }
+    printf("\n");
+
+    printf("%d,%d,%d,%s,%s,%d,%d,%.3lf,%.3lf,%.3lf,%.6le,%.4lf,%d,%d", p, num_iterations, board_size, opts->engine, RULE.name,
+           opts->threads, opts->halo_depth, runtime*1000000, total_comm_time*1000000, single_generation_runtime*1000000,
+           runtime > 0 ? (double)HEIGHT*WIDTH*num_iterations/runtime : 0.0, stats->imbalance, steady_generation, steady_period);
+    for (int t = 0; t < TIMER_COUNT; t++)
+    {
+        printf(",%.3lf,%.3lf,%.3lf,%.3lf", stats->timers[t].min*1000000, stats->timers[t].mean*1000000,
+               stats->timers[t].max*1000000, stats->timers[t].p99*1000000);
+    }
+    printf("\n");
+}
+
+int ParseOptions(int argc, char** argv, GolOptions* opts)
+{
+    opts->engine = "grid";
+    opts->print_board = 0;
+    opts->overlap = 0;
+    opts->kernel = "auto";
+    opts->threads = 1;
+    opts->pages = GOL_PAGES_DEFAULT;
+    opts->tile_size = 0;
+    opts->halo_depth = 1;
+    opts->hashlife_nodes = 1u << 22;
+    opts->proc_rows = 0;
+    opts->proc_cols = 0;
+    opts->snapshot = NULL;
+    opts->checkpoint_every = 0;
+    opts->checkpoint_file = "gol_checkpoint.bin";
+    opts->restart = NULL;
+    opts->metrics = GOL_METRICS_TEXT;
+    opts->balance_every = 0;
+    opts->seed_given = 0;
+    opts->seed = 0;
+    opts->barrier = 0;
+    opts->temporal_rows = 0;
+    opts->detect_period = 0;
+    opts->halo_transport = GOL_HALO_MSG;
+    opts->ooc_dir = ".";
+    opts->ooc_band = 256;
+
+    // optional flags follow <num_iterations> <board_size>
+    for (int i = 3; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--engine=", 9) == 0)
+        {
+            opts->engine = argv[i] + 9;
+            if (strcmp(opts->engine, "grid") != 0 && strcmp(opts->engine, "classic") != 0 &&
+                strcmp(opts->engine, "packed") != 0 && strcmp(opts->engine, "hashlife") != 0 &&
+                strcmp(opts->engine, "ooc") != 0)
+            {
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--print") == 0)
+        {
+            opts->print_board = 1;
+        }
+        else if (strcmp(argv[i], "--overlap") == 0)
+        {
+            opts->overlap = 1;
+        }
+        else if (strcmp(argv[i], "--barrier") == 0)
+        {
+            opts->barrier = 1;
+        }
+        else if (strncmp(argv[i], "--threads=", 10) == 0)
+        {
+            opts->threads = atoi(argv[i] + 10);
+            if (opts->threads < 1)
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--pages=", 8) == 0)
+        {
+            // board storage backing: aligned heap, transparent or explicit huge pages
+            const char* pages = argv[i] + 8;
+            if (strcmp(pages, "default") == 0)
+            {
+                opts->pages = GOL_PAGES_DEFAULT;
+            }
+            else if (strcmp(pages, "thp") == 0)
+            {
+                opts->pages = GOL_PAGES_THP;
+            }
+            else if (strcmp(pages, "hugetlb") == 0)
+            {
+                opts->pages = GOL_PAGES_HUGETLB;
+            }
+            else
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--kernel=", 9) == 0)
+        {
+            opts->kernel = argv[i] + 9;
+            if (strcmp(opts->kernel, "auto") != 0 && strcmp(opts->kernel, "scalar") != 0 &&
+                strcmp(opts->kernel, "avx2") != 0 && strcmp(opts->kernel, "avx512") != 0)
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--tiles=", 8) == 0)
+        {
+            opts->tile_size = atoi(argv[i] + 8);
+            if (opts->tile_size < 1)
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--halo-depth=", 13) == 0)
+        {
+            opts->halo_depth = atoi(argv[i] + 13);
+            if (opts->halo_depth < 1)
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--hashlife-nodes=", 17) == 0)
+        {
+            // quadtree nodes kept before unreachable ones are evicted
+            int nodes = atoi(argv[i] + 17);
+            if (nodes < 1024)
+            {
+                return -1;
+            }
+            opts->hashlife_nodes = (uint32_t)nodes;
+        }
+        else if (strncmp(argv[i], "--procs=", 8) == 0)
+        {
+            // process grid as <rows>x<cols>, e.g. --procs=4x2
+            if (sscanf(argv[i] + 8, "%dx%d", &opts->proc_rows, &opts->proc_cols) != 2 ||
+                opts->proc_rows < 1 || opts->proc_cols < 1)
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--rule=", 7) == 0)
+        {
+            // life-like rule in B/S notation, e.g. --rule=B3/S23, or Larger
+            // than Life in Golly's, e.g. --rule=R5,C0,M1,S34..58,B34..45,NM
+            if (ParseRule(argv[i] + 7) != 0)
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--metrics=", 10) == 0)
+        {
+            const char* metrics = argv[i] + 10;
+            if (strcmp(metrics, "text") == 0)
+            {
+                opts->metrics = GOL_METRICS_TEXT;
+            }
+            else if (strcmp(metrics, "json") == 0)
+            {
+                opts->metrics = GOL_METRICS_JSON;
+            }
+            else if (strcmp(metrics, "csv") == 0)
+            {
+                opts->metrics = GOL_METRICS_CSV;
+            }
+            else
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--temporal=", 11) == 0)
+        {
+            // sweep each halo batch as one wavefront of this many rows per tile
+            opts->temporal_rows = atoi(argv[i] + 11);
+            if (opts->temporal_rows < 1)
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--halo=", 7) == 0)
+        {
+            const char* transport = argv[i] + 7;
+            if (strcmp(transport, "msg") == 0)
+            {
+                opts->halo_transport = GOL_HALO_MSG;
+            }
+            else if (strcmp(transport, "shm") == 0)
+            {
+                opts->halo_transport = GOL_HALO_SHM;
+            }
+            else if (strcmp(transport, "rma") == 0)
+            {
+                opts->halo_transport = GOL_HALO_RMA;
+            }
+            else
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--detect=", 9) == 0)
+        {
+            // stop early once the board repeats with period <= K
+            opts->detect_period = atoi(argv[i] + 9);
+            if (opts->detect_period < 1)
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--balance=", 10) == 0)
+        {
+            // rebalance rows between process rows every N generations
+            opts->balance_every = atoi(argv[i] + 10);
+            if (opts->balance_every < 1)
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--seed=", 7) == 0)
+        {
+            // the same seed gives the same initial board for any process count
+            char* end = NULL;
+            opts->seed = strtoull(argv[i] + 7, &end, 0);
+            if (end == argv[i] + 7 || *end != '\0')
+            {
+                return -1;
+            }
+            opts->seed_given = 1;
+        }
+        else if (strncmp(argv[i], "--snapshot=", 11) == 0)
+        {
+            opts->snapshot = argv[i] + 11;
+        }
+        else if (strncmp(argv[i], "--checkpoint=", 13) == 0)
+        {
+            opts->checkpoint_every = atoi(argv[i] + 13);
+            if (opts->checkpoint_every < 1)
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(argv[i], "--checkpoint-file=", 18) == 0)
+        {
+            opts->checkpoint_file = argv[i] + 18;
+        }
+        else if (strncmp(argv[i], "--restart=", 10) == 0)
+        {
+            opts->restart = argv[i] + 10;
+        }
+        else if (strncmp(argv[i], "--ooc-dir=", 10) == 0)
+        {
+            // a local disk with room for two boards' worth of this proc's rows
+            opts->ooc_dir = argv[i] + 10;
+        }
+        else if (strncmp(argv[i], "--ooc-band=", 11) == 0)
+        {
+            opts->ooc_band = atoi(argv[i] + 11);
+            if (opts->ooc_band < 1)
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            return -1;
+        }
+    }
+
+    // snapshots are written from the grid engine's 2D blocks
+    if ((opts->snapshot != NULL || opts->checkpoint_every > 0 || opts->restart != NULL) &&
+        strcmp(opts->engine, "grid") != 0)
+    {
+        return -1;
+    }
+
+    // row migration is done on the grid engine's blocks
+    if (opts->balance_every > 0 && strcmp(opts->engine, "grid") != 0)
+    {
+        return -1;
+    }
+
+    // the wavefront replaces the grid engine's per-generation sweeps, including overlap's split step
+    if (opts->temporal_rows > 0 && (strcmp(opts->engine, "grid") != 0 || opts->tile_size > 0 || opts->overlap))
+    {
+        return -1;
+    }
+
+    // shared or exposed boards sit in a window sized once, and every edge goes every exchange
+    if (opts->halo_transport != GOL_HALO_MSG && (strcmp(opts->engine, "grid") != 0 || opts->tile_size > 0 ||
+                                                 opts->balance_every > 0))
+    {
+        return -1;
+    }
+
+    // detection fingerprints every generation's board, which the wavefront never holds whole
+    if (opts->detect_period > 0 && ((strcmp(opts->engine, "grid") != 0 && strcmp(opts->engine, "packed") != 0) ||
+                                    opts->temporal_rows > 0))
+    {
+        return -1;
+    }
+
+    // active tiles track single generations, one ghost layer at a time
+    if (opts->tile_size > 0 && (opts->halo_depth != 1 || opts->overlap))
+    {
+        return -1;
+    }
+
+    // only the grid engine's ghost frame is as deep as a wide stencil needs
+    if (RULE.radius > 1 && (strcmp(opts->engine, "grid") != 0 || opts->tile_size > 0))
+    {
+        return -1;
+    }
+
+    return 0;
 }
 
 int main(int argc, char** argv)
 {
     int rank,p;
-    MPI_Init(&argc, &argv);
+
+    // worker threads inside a rank only compute; all MPI calls stay on the main thread
+    int thread_level = MPI_THREAD_SINGLE;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_level);
     MPI_Comm_size(MPI_COMM_WORLD, &p);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
@@ -456,11 +800,12 @@ int main(int argc, char** argv)
         }
     }
 
-    if (argc != 3)
+    GolOptions opts;
+    if (argc < 3 || ParseOptions(argc, argv, &opts) != 0)
     {
         if (rank == 0)
         {
-            printf("usage: ./run_GOL.sh <num_iterations> <board_size> <num_threads>\n");
+            printf("usage: ./run_GOL.sh <num_iterations> <board_size> <num_threads> [--engine=grid|classic|packed|hashlife|ooc] [--print] [--rule=B3/S23|Rr,C0,Mm,Sa..b,Bc..d,NM] [--overlap] [--barrier] [--procs=RxC] [--halo=msg|shm|rma] [--halo-depth=k] [--temporal=B] [--detect=K] [--tiles=T] [--kernel=auto|scalar|avx2|avx512] [--threads=N] [--pages=default|thp|hugetlb] [--hashlife-nodes=N] [--seed=S] [--metrics=text|json|csv] [--balance=N] [--snapshot=FILE] [--checkpoint=N] [--checkpoint-file=FILE] [--restart=FILE] [--ooc-dir=DIR] [--ooc-band=R]\n");
             printf("argv= ");
             for (int i = 0; i < argc; i++)
             {
@@ -468,6 +813,7 @@ int main(int argc, char** argv)
             }
             printf("\n");
         }
+        MPI_Finalize();
         return -1;
     }
 
@@ -480,7 +826,7 @@ int main(int argc, char** argv)
         _board_size = atoi(argv[2]);
         if (_num_iterations == 0 || _board_size == 0)
         {
-            printf("usage: ./run_GOL.sh <num_iterations> <board_size> <num_threads>\n");
+            printf("usage: ./run_GOL.sh <num_iterations> <board_size> <num_threads> [--engine=grid|classic|packed|hashlife|ooc] [--print] [--rule=B3/S23|Rr,C0,Mm,Sa..b,Bc..d,NM] [--overlap] [--barrier] [--procs=RxC] [--halo=msg|shm|rma] [--halo-depth=k] [--temporal=B] [--detect=K] [--tiles=T] [--kernel=auto|scalar|avx2|avx512] [--threads=N] [--pages=default|thp|hugetlb] [--hashlife-nodes=N] [--seed=S] [--metrics=text|json|csv] [--balance=N] [--snapshot=FILE] [--checkpoint=N] [--checkpoint-file=FILE] [--restart=FILE] [--ooc-dir=DIR] [--ooc-band=R]\n");
             printf("argv= ");
             for (int i = 0; i < argc; i++)
             {
@@ -506,6 +852,43 @@ int main(int argc, char** argv)
 
     HEIGHT = WIDTH = _board_size;
 
+    if (opts.threads > 1 && thread_level < MPI_THREAD_FUNNELED)
+    {
+        if (rank == 0)
+        {
+            printf("MPI library does not provide MPI_THREAD_FUNNELED, running with 1 thread per proc\n");
+        }
+        opts.threads = 1;
+    }
+    PAGE_MODE = opts.pages;
+    GENERATION_BARRIER = opts.barrier;
+
+#ifdef _OPENMP
+    omp_set_num_threads(opts.threads);
+#else
+    opts.threads = 1;
+#endif
+
+    if (opts.proc_rows != 0 && opts.proc_rows*opts.proc_cols != p)
+    {
+        if (rank == 0)
+        {
+            printf("--procs=%dx%d does not match the %d processes\n", opts.proc_rows, opts.proc_cols, p);
+        }
+        MPI_Finalize();
+        return -1;
+    }
+
+
+    // without --seed every run gets a fresh board; p0 picks it and everyone else is told
+    SEED = opts.seed;
+    if (!opts.seed_given)
+    {
+        SEED = (uint64_t)time(NULL);
+        MPI_Bcast(&SEED, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    }
+
+    TimingReset();
 
     // start recording time for total_runtime metric
     double start_total_runtime = MPI_Wtime();
@@ -516,11 +899,42 @@ int main(int argc, char** argv)
         printf("proc%d WIDTH=%d\n", rank, WIDTH);
     }
 
-    int partial_board[(HEIGHT/p)][WIDTH];
+    if (strcmp(opts.engine, "grid") == 0)
+    {
+        SimulateGrid(rank, p, _num_iterations, &opts);
+    }
+    else if (strcmp(opts.engine, "hashlife") == 0)
+    {
+        SimulateHashLife(rank, p, _num_iterations, &opts);
+    }
+    else if (strcmp(opts.engine, "packed") == 0)
+    {
+        SimulatePacked(rank, p, _num_iterations, &opts);
+    }
+    else if (strcmp(opts.engine, "ooc") == 0)
+    {
+        SimulateOutOfCore(rank, p, _num_iterations, &opts);
+    }
+    else
+    {
+        // heap storage, so large boards no longer overflow the stack
+        GolBlock board_block;
+        int (*partial_board)[WIDTH] = GolAlloc(&board_block, sizeof(int)*(HEIGHT/p)*WIDTH);
+
+        GenerateInitialGOL(partial_board, rank, p);
 
-    GenerateInitialGOL(partial_board, rank, p);
+        Simulate(partial_board, rank, p, _num_iterations);
 
-    Simulate(partial_board, rank, p, _num_iterations);
+        board_bytes_per_proc = (double)(HEIGHT/p)*WIDTH*sizeof(int);
+        halo_bytes_per_generation = 2.0*WIDTH*sizeof(int);
+
+        if (opts.print_board)
+        {
+            PrintBoard(partial_board, rank, p);
+        }
+
+        GolFree(&board_block);
+    }
 
     // end recording time for total_runtime metric
     double end_total_runtime = MPI_Wtime();
@@ -533,18 +947,148 @@ int main(int argc, char** argv)
     // get max of each metric
     MPI_Allreduce(MPI_IN_PLACE, &total_runtime, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
     MPI_Allreduce(MPI_IN_PLACE, &total_comm_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    // the slowest rank's mean generation; engines that do not time generations (hashlife) leave it 0
+    single_generation_runtime = TimingMean(TIMER_GENERATION);
     MPI_Allreduce(MPI_IN_PLACE, &single_generation_runtime, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
-
-    if (rank == 0)
+    MPI_Allreduce(MPI_IN_PLACE, &overlap_window_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &owned_cell_updates, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &redundant_cell_updates, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &halo_messages, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &halo_shared_edges, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &snapshot_bytes, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &snapshot_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &balance_rows_moved, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &balance_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    GolTimingStats stats;
+    double* rank_sums = (double*)malloc(sizeof(double)*p*TIMER_COUNT);
+    TimingReduce(&stats, rank_sums);
+
+    if (rank == 0 && opts.metrics == GOL_METRICS_JSON)
+    {
+        PrintMetricsJson(&opts, p, _num_iterations, _board_size, total_runtime, &stats, rank_sums);
+    }
+    else if (rank == 0 && opts.metrics == GOL_METRICS_CSV)
+    {
+        PrintMetricsCsv(&opts, p, _num_iterations, _board_size, total_runtime, &stats);
+    }
+    else if (rank == 0)
     {
         printf("--------------------------\n");
         printf("num_procs = %d    num_iterations = %d    board_size = %d\n", p, _num_iterations, _board_size);
+        printf("engine = %s    threads per proc = %d    rule = %s    seed = %llu\n", opts.engine, opts.threads,
+               RULE.name, (unsigned long long)SEED);
         printf("--------------------------\n");
         printf("total runtime=%lf microseconds\n", total_runtime*1000000);
-        printf("average single generation time=%lf microseconds\n", (total_runtime/_num_iterations)*1000000);
+        printf("average single generation time=%lf microseconds\n",
+               (single_generation_runtime > 0 ? single_generation_runtime : total_runtime/_num_iterations)*1000000);
         printf("communication time=%lf microseconds\n", total_comm_time*1000000);
         printf("total computation time=%lf microseconds\n", (total_runtime - total_comm_time)*1000000);
+        printf("board memory per proc=%.0lf bytes    pages=%s\n", board_bytes_per_proc, page_mode_used);
+        printf("halo traffic per proc per generation=%.0lf bytes\n", halo_bytes_per_generation);
+        if (strcmp(opts.engine, "grid") == 0)
+        {
+            // deep halo trades fewer messages for recomputing part of each neighbor's block;
+            // edges are summed over all procs, and a run stopped early divides by the generations it ran
+            double proc_generations = (double)p*(stats.generations > 0 ? stats.generations : _num_iterations);
+            printf("halo depth=%d    halo exchanges=%.0lf    messages sent per proc per generation=%.2lf    shared-memory edges per proc per generation=%.2lf\n",
+                   opts.halo_depth, halo_exchanges, halo_messages/proc_generations, halo_shared_edges/proc_generations);
+            printf("halo transport=%s    edges through shared memory=%.1lf%%\n", halo_transport_name,
+                   100.0*halo_shared_fraction);
+            printf("redundant ghost cell updates=%.2lf%% of owned cell updates\n",
+                   owned_cell_updates > 0 ? 100.0*redundant_cell_updates/owned_cell_updates : 0.0);
+
+            double compute_time = total_runtime - total_comm_time;
+            printf("kernel=%s (%s rule)    cells per second=%.4le\n", kernel_name, rule_kernel,
+                   compute_time > 0 ? owned_cell_updates/compute_time : 0.0);
+        }
+        if (strcmp(opts.engine, "ooc") == 0)
+        {
+            // board memory above is only the mapped window; the boards themselves are on disk
+            printf("out-of-core bands=%d rows    board files per proc=%.0lf bytes in %s\n", opts.ooc_band,
+                   ooc_file_bytes, opts.ooc_dir);
+        }
+        if (opts.temporal_rows > 0)
+        {
+            // the wavefront only saves traffic while its live rows stay in cache
+            printf("temporal blocking=%d generations x %d-row tiles    working set=%.0lf bytes\n",
+                   opts.halo_depth, opts.temporal_rows, temporal_working_set);
+            printf("est. board traffic per proc per generation: single sweep=%.0lf bytes    temporal=%.0lf bytes    saved=%.1lf%%\n",
+                   sweep_bytes_per_generation, temporal_bytes_per_generation, sweep_bytes_per_generation > 0 ?
+                   100.0*(1.0 - temporal_bytes_per_generation/sweep_bytes_per_generation) : 0.0);
+        }
+        if (opts.detect_period > 0)
+        {
+            if (steady_generation >= 0)
+            {
+                printf("steady state: generation %d repeats generation %d    period=%d%s    generations skipped=%d\n",
+                       steady_generation, steady_generation - steady_period, steady_period,
+                       steady_period == 1 ? " (still life)" : "", _num_iterations - steady_generation);
+            }
+            else
+            {
+                printf("steady state: no repeat with period <= %d in %d generations\n", opts.detect_period, _num_iterations);
+            }
+
+            // at most 16 evenly spaced points, always including the last generation checked
+            int stride = (population_generations + 15)/16;
+            printf("population trajectory (generation:live cells)=");
+            for (int g = 0; g < population_generations; g += stride)
+            {
+                printf("%s%d:%.0lf", g ? " " : "", population_first_generation + g, population_trajectory[g]);
+            }
+            if ((population_generations - 1) % stride != 0)
+            {
+                printf(" %d:%.0lf", population_first_generation + population_generations - 1, population_trajectory[population_generations - 1]);
+            }
+            printf("\n");
+        }
+        if (opts.tile_size > 0)
+        {
+            printf("active tiles=%dx%d    tiles updated=%.2lf%%    halo edges skipped=%.2lf%%\n", opts.tile_size,
+                   opts.tile_size, 100.0*tile_update_fraction, 100.0*halo_edge_skip_fraction);
+        }
+        if (strcmp(opts.engine, "hashlife") == 0)
+        {
+            printf("hashlife population=%.0lf    peak nodes=%.0lf    node collections=%d\n",
+                   hashlife_population, hashlife_peak_nodes, hashlife_collections);
+            printf("hashlife memory=%.0lf bytes    memo hit rate=%.1lf%%\n", hashlife_bytes, 100.0*hashlife_hit_rate);
+        }
+        if (snapshot_count > 0)
+        {
+            // every write is a full board, so bytes/time is the aggregate file bandwidth
+            printf("snapshots written=%d    snapshot bytes=%.0lf    snapshot time=%lf microseconds    bandwidth=%.2lf MB/s\n",
+                   snapshot_count, snapshot_bytes, snapshot_time*1000000,
+                   snapshot_time > 0 ? snapshot_bytes/snapshot_time/1e6 : 0.0);
+        }
+        if (opts.balance_every > 0)
+        {
+            printf("load balancing every %d generations: checks=%d    rebalances=%d    rows migrated=%.0lf    balancing time=%lf microseconds\n",
+                   opts.balance_every, balance_checks, balance_rebalances, balance_rows_moved, balance_time*1000000);
+            printf("rows per process row=%s    band imbalance at last check=%.3lf\n", balance_layout, balance_imbalance);
+        }
+        if (opts.overlap)
+        {
+            // share of each exchange's in-flight time that was covered by interior compute
+            double in_flight = overlap_window_time + total_comm_time;
+            printf("compute overlapped with communication=%lf microseconds\n", overlap_window_time*1000000);
+            printf("halo exchange hidden behind compute=%.1lf%%\n", in_flight > 0 ? 100.0*overlap_window_time/in_flight : 0.0);
+        }
+        if (stats.generations > 0)
+        {
+            // every generation of every rank is one sample
+            printf("per-generation timers over %d procs x %.0lf generations (microseconds):\n", p, stats.generations);
+            printf("%12s %12s %12s %12s %12s\n", "phase", "min", "mean", "max", "p99");
+            for (int t = 0; t < TIMER_COUNT; t++)
+            {
+                printf("%12s %12.3lf %12.3lf %12.3lf %12.3lf\n", TIMER_NAMES[t], stats.timers[t].min*1000000,
+                       stats.timers[t].mean*1000000, stats.timers[t].max*1000000, stats.timers[t].p99*1000000);
+            }
+            printf("load imbalance (max/mean compute time per proc)=%.3lf\n", stats.imbalance);
+        }
     }
+    free(rank_sums);
+    free(population_trajectory);
 
     MPI_Finalize();
     return 0;
@@ -0,0 +1,388 @@
+/*
+* Ethan Vincent
+* Shared declarations for the parallel Game of Life engines
+*/
+
+#ifndef GOL_H
+#define GOL_H
+
+#include <stdint.h>
+
+#include <mpi.h>
+
+#define __DEBUG__ 0
+
+// Globals for time keeping
+extern double total_runtime;
+extern double single_generation_runtime;
+extern double total_comm_time;
+
+// Globals for game board
+extern int HEIGHT;
+extern int WIDTH;
+
+// Board storage (gol_alloc.c)
+enum { GOL_PAGES_DEFAULT, GOL_PAGES_THP, GOL_PAGES_HUGETLB };
+
+typedef struct
+{
+    void* ptr;
+    size_t bytes;           // bytes actually reserved
+    int mapped;             // 1 if ptr came from mmap rather than the heap
+} GolBlock;
+
+extern int PAGE_MODE;
+extern const char* page_mode_used;
+
+void* GolAlloc(GolBlock* block, size_t bytes);
+void GolFree(GolBlock* block);
+
+// Life-like rule (gol_rule.c): bit c of birth/survive set if a count of c
+// neighbors makes a dead cell alive / keeps a live cell alive. Radius > 1
+// is a Larger than Life rule, alive next iff the count over the
+// (2r+1) x (2r+1) box falls in the birth or survive range
+typedef struct
+{
+    uint16_t birth;
+    uint16_t survive;
+    int radius;             // 1 for B/S rules
+    int birth_min, birth_max;
+    int survive_min, survive_max;
+    int middle;             // the box count includes the cell itself
+    char name[64];          // canonical B/S or Rr,C0,Mm,Sa..b,Bc..d,NM string
+} GolRule;
+
+extern GolRule RULE;
+extern uint8_t RULE_TABLE[2][9];    // next state by [current state][neighbor_sum]
+
+int ParseRule(const char* text);
+int RuleIsDefault(void);
+
+// Metrics block format
+enum { GOL_METRICS_TEXT, GOL_METRICS_JSON, GOL_METRICS_CSV };
+
+// Command line options (everything after <num_iterations> <board_size>)
+typedef struct
+{
+    const char* engine;     // "grid", "classic", "packed", "hashlife" or "ooc"
+    int print_board;        // dump the final board from p0
+    int overlap;            // overlap the halo exchange with interior rows
+    const char* kernel;     // row kernel: "auto", "scalar", "avx2" or "avx512"
+    int threads;            // worker threads per proc (grid engine)
+    int pages;              // GOL_PAGES_* backing for board storage
+    int tile_size;          // active-tile side (0 = update every cell)
+    int halo_depth;         // ghost depth k: exchange once every k generations
+    uint32_t hashlife_nodes;    // node table size that triggers eviction
+    int proc_rows;          // process grid for the grid engine (0 = let MPI_Dims_create pick)
+    int proc_cols;
+    const char* snapshot;   // write the final board here (grid engine)
+    int checkpoint_every;   // checkpoint every N generations (0 = never)
+    const char* checkpoint_file;
+    const char* restart;    // start from this snapshot instead of a random board
+    int metrics;            // GOL_METRICS_* output of the metrics block
+    int balance_every;      // rebalance rows every N generations (0 = fixed blocks)
+    int seed_given;         // --seed was passed; otherwise SEED comes from the clock
+    uint64_t seed;
+    int barrier;            // global MPI_Barrier every generation (off: neighbors pace each other)
+    int temporal_rows;      // rows per wavefront tile when a halo batch is swept at once (0 = off)
+    int detect_period;      // stop once the board repeats with period <= this (0 = never check)
+    int halo_transport;     // GOL_HALO_* used for the grid engine's exchange
+    const char* ooc_dir;    // where the out-of-core engine keeps its board files
+    int ooc_band;           // rows per band of an out-of-core sweep
+} GolOptions;
+
+// 1 to synchronize all procs at the top of every generation (--barrier)
+extern int GENERATION_BARRIER;
+
+// Memory and traffic numbers reported by the engines in the metrics block
+extern double board_bytes_per_proc;
+extern double halo_bytes_per_generation;
+
+// Temporal blocking: estimated board bytes streamed per proc per generation
+// by the generation-at-a-time sweep and by the wavefront, and the rows the
+// wavefront keeps live
+extern double sweep_bytes_per_generation;
+extern double temporal_bytes_per_generation;
+extern double temporal_working_set;
+
+// Halo transport the grid engine ran with and the share of its edges that
+// went through shared memory instead of messages
+extern const char* halo_transport_name;
+extern double halo_shared_fraction;
+
+// Compute time spent while a halo exchange was in flight (overlap mode)
+extern double overlap_window_time;
+
+// Deep-halo bookkeeping: exchanges done, and cell updates on owned vs ghost cells
+extern double halo_exchanges;
+extern double owned_cell_updates;
+extern double redundant_cell_updates;
+
+// Halo edges this proc sent as messages and read through shared memory
+extern double halo_messages;
+extern double halo_shared_edges;
+
+// HashLife results and memory use (filled on p0)
+extern double hashlife_population;
+extern double hashlife_peak_nodes;
+extern double hashlife_bytes;
+extern double hashlife_hit_rate;
+extern int hashlife_collections;
+
+// Row kernel the grid engine ran with, and whether its rule was compiled in or table driven
+extern const char* kernel_name;
+extern const char* rule_kernel;
+
+// Active-tile results: fraction of tiles recomputed and halo edges skipped
+extern double tile_update_fraction;
+extern double halo_edge_skip_fraction;
+
+// Load balancing: balance points, ones that moved rows, rows received,
+// time spent, and the final rows per process row
+extern int balance_checks;
+extern int balance_rebalances;
+extern double balance_rows_moved;
+extern double balance_time;
+extern double balance_imbalance;
+extern char balance_layout[256];
+
+// Steady-state detection: generation whose board repeated one steady_period
+// generations earlier (-1 if none), and the live-cell count of every generation
+// checked from population_first_generation on
+extern int steady_generation;
+extern int steady_period;
+extern double* population_trajectory;
+extern int population_generations;
+extern int population_first_generation;
+
+// Out-of-core engine: bytes of board files per proc on disk
+extern double ooc_file_bytes;
+
+// Snapshot writes (final dump and checkpoints) and the time they took
+extern double snapshot_bytes;
+extern double snapshot_time;
+extern int snapshot_count;
+
+/*
+* Ghost-padded board: the owned rows x cols block sits inside a frame of
+* ghost cells (halo rows from the neighboring procs, wrapped columns), so
+* the stencil never has to test for an edge. Two boards live back to back
+* in one allocation and are swapped by pointer every generation.
+*/
+typedef struct
+{
+    int rows;               // rows owned by this proc
+    int cols;               // columns owned by this proc
+    int row0;               // global index of owned row 0
+    int col0;               // global index of owned column 0
+    int ghost;              // depth of the ghost frame
+    int stride;             // bytes per padded row
+    size_t plane;           // bytes per padded board
+    GolBlock storage;       // both boards
+    uint8_t* cur;           // generation being read
+    uint8_t* next;          // generation being written
+} GolGrid;
+
+// pointer to owned cell (i, 0) of board; i and column offsets may reach into the ghost frame
+static inline uint8_t* GridRow(const GolGrid* grid, uint8_t* board, int i)
+{
+    return board + (size_t)(i + grid->ghost)*grid->stride + grid->ghost;
+}
+
+/*
+* 2D periodic block decomposition and the halo exchange between a block and
+* its eight neighbors. Directions are ordered so that opposite(d) == 7 - d.
+*/
+#define HALO_DIRECTIONS 8
+
+typedef struct
+{
+    MPI_Comm cart;
+    int dims[2];
+    int coords[2];
+    int neighbors[HALO_DIRECTIONS];
+    MPI_Datatype send_types[HALO_DIRECTIONS];   // owned cells each neighbor needs
+    MPI_Datatype recv_types[HALO_DIRECTIONS];   // ghost cells each neighbor fills
+    int send_counts[HALO_DIRECTIONS];           // 1, or 0 to skip an unchanged edge
+    MPI_Request requests[2*HALO_DIRECTIONS];
+    MPI_Status statuses[2*HALO_DIRECTIONS];
+    int persistent;                             // exchange through persistent requests
+    uint8_t* persistent_base;                   // board the first request set was built on
+    MPI_Request persistent_requests[2][2*HALO_DIRECTIONS];  // one set per board parity
+    int persistent_count;
+    MPI_Request* active;                        // requests HaloEnd waits on
+    int active_count;
+    int transport;                              // GOL_HALO_* path for same-node edges
+    int node_ranks[HALO_DIRECTIONS];            // neighbor's rank in node, or MPI_UNDEFINED if messaged
+    MPI_Comm node;                              // procs sharing this node's memory
+    MPI_Win window;                             // the boards, for the shared-memory and RMA transports
+    uint8_t* window_base;                       // this proc's first board in the window
+    MPI_Datatype put_types[HALO_DIRECTIONS];    // neighbor's ghost region we put into (RMA)
+    MPI_Aint put_planes[HALO_DIRECTIONS];       // neighbor's board size, to reach its second board
+    MPI_Group neighbor_group;                   // distinct neighbors, for post/start (RMA)
+    struct GolShmHeader* shm_header;            // this proc's exchange state in the window
+    struct GolShmHeader* shm_neighbors[HALO_DIRECTIONS];
+    uint64_t epoch;                             // exchanges started so far
+} GolHalo;
+
+// halo transport: messages for every edge, shared memory between procs on a
+// node, or one-sided puts into the neighbors' ghost frames
+enum { GOL_HALO_MSG, GOL_HALO_SHM, GOL_HALO_RMA };
+
+/*
+* Active-tile tracking: the owned block is cut into size x size tiles and
+* only tiles whose neighborhood changed last generation are recomputed.
+*/
+typedef struct
+{
+    int size;
+    int tile_rows;
+    int tile_cols;
+    uint8_t* changed;       // tile differs between the last two generations
+    uint8_t* changed_next;
+    double tiles_updated;
+    double tiles_total;
+    double edges_skipped;
+    double edges_total;
+} GolTiles;
+
+/*
+* Row load balancing: band k (process row k) owns board rows
+* [starts[k], starts[k+1]), moved at balance points by measured speed.
+*/
+typedef struct
+{
+    int bands;
+    int* starts;
+    MPI_Comm column;        // procs sharing this proc's process column
+    double window_start;    // compute time at the last balance point
+    int checks;
+    int rebalances;
+    double rows_moved;      // rows received from other bands
+    double time;            // deciding and migrating
+    double imbalance;       // slowest band / mean band at the last check
+} GolBalance;
+
+extern const int HALO_OFFSETS[HALO_DIRECTIONS][2];
+
+// computes n cells of one row of the next generation from the rows above, at and below it
+typedef void (*GolRowKernel)(const uint8_t* above, const uint8_t* mid, const uint8_t* below, uint8_t* out, int n);
+
+/*
+* Counter-based initial board: cells j..j+63 of row i (j a multiple of 64)
+* are the bits of one splitmix64 hash of (SEED, i, j/64). Any proc can
+* produce any cell without a shared stream, so the board depends on the
+* seed alone, not on the process count or thread schedule.
+*/
+extern uint64_t SEED;
+
+static inline uint64_t InitialWord(int i, int w)
+{
+    uint64_t z = SEED + (((uint64_t)i << 32 | (uint32_t)w) + 1)*0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint8_t InitialCell(int i, int j)
+{
+    return (InitialWord(i, j >> 6) >> (j & 63)) & 1;
+}
+
+void InitialRow(int i, int j0, int n, uint8_t* out);
+
+// vectorized row kernels (gol_simd.c)
+GolRowKernel SelectRowKernel(const char* kernel, const char** name);
+
+// halo exchange (gol_halo.c)
+int BlockSize(int n, int parts, int i);
+int BlockStart(int n, int parts, int i);
+void HaloCreate(GolHalo* halo, const GolOptions* opts, int p);
+void HaloSubarray(int rows, int cols, int ghost, int stride, int d, int recv, MPI_Datatype* type);
+void HaloSetTypes(GolHalo* halo, GolGrid* grid);
+void HaloRegion(GolGrid* grid, int d, int ghost, int* r0, int* r1, int* c0, int* c1);
+void HaloFree(GolHalo* halo);
+void HaloBegin(GolHalo* halo, GolGrid* grid);
+void HaloEnd(GolHalo* halo, GolGrid* grid);
+
+// shared-memory halo transport (gol_shm.c)
+void HaloShareGrid(GolHalo* halo, GolGrid* grid);
+void HaloSharedPublish(GolHalo* halo, GolGrid* grid);
+void HaloSharedCopy(GolHalo* halo, GolGrid* grid);
+void HaloSharedDone(GolHalo* halo);
+void HaloSharedFree(GolHalo* halo);
+
+// one-sided halo transport (gol_rma.c)
+void HaloExposeGrid(GolHalo* halo, GolGrid* grid);
+void HaloPutBegin(GolHalo* halo, GolGrid* grid);
+void HaloPutEnd(GolHalo* halo);
+void HaloExposeFree(GolHalo* halo);
+
+// ghost-padded engine (gol_grid.c)
+int GridStride(int cols, int ghost);
+void GridCreate(GolGrid* grid, int rows, int cols, int ghost);
+void GridCreateBlock(GolGrid* grid, GolHalo* halo, int ghost);
+void GridFirstTouch(GolGrid* grid);
+void GridStepRegion(GolGrid* grid, int r0, int r1, int c0, int c1);
+
+// Larger than Life region step (gol_ltl.c)
+void LtlCreate(int width, int threads);
+void LtlFree(void);
+void LtlStepRegion(GolGrid* grid, int r0, int r1, int c0, int c1);
+
+// active tiles (gol_tiles.c)
+void TilesCreate(GolTiles* tiles, GolGrid* grid, int size);
+void TilesFree(GolTiles* tiles);
+void TilesStep(GolTiles* tiles, GolGrid* grid, GolHalo* halo);
+void GridFree(GolGrid* grid);
+void SimulateGrid(int rank, int p, int num_iterations, const GolOptions* opts);
+
+// row load balancing (gol_balance.c)
+void BalanceCreate(GolBalance* balance, GolHalo* halo);
+void BalanceFree(GolBalance* balance);
+int BalanceStep(GolBalance* balance, GolGrid* grid, GolHalo* halo, int min_rows);
+
+// per-generation phase timers (gol_timing.c)
+enum { TIMER_PACK, TIMER_WAIT, TIMER_COMPUTE, TIMER_BARRIER, TIMER_GENERATION, TIMER_COUNT };
+
+typedef struct
+{
+    struct
+    {
+        double min, mean, max, p99;
+    } timers[TIMER_COUNT];  // over all generations of all ranks, in seconds
+    double generations;     // generations timed per rank
+    double imbalance;       // slowest rank's compute time / mean rank's
+} GolTimingStats;
+
+extern const char* TIMER_NAMES[TIMER_COUNT];
+
+void TimingReset(void);
+void TimingBeginGeneration(void);
+void TimingAdd(int timer, double seconds);
+void TimingEndGeneration(void);
+void TimingEndGenerations(int n);
+double TimingMean(int timer);
+double TimingSum(int timer);
+void TimingReduce(GolTimingStats* stats, double* rank_sums);
+
+// MPI-IO snapshots (gol_io.c)
+void WriteSnapshot(const char* path, GolGrid* grid, GolHalo* halo, long long generation);
+long long ReadSnapshot(const char* path, GolGrid* grid, GolHalo* halo);
+
+// steady-state detection (gol_detect.c)
+void DetectCreate(int period, int start, int num_iterations);
+void DetectFree(void);
+void HashCells(const uint8_t* cells, size_t n, uint64_t key, uint64_t* hash, uint64_t* check);
+int DetectStep(uint64_t hash, uint64_t check, uint64_t population, int generation);
+
+// HashLife engine (gol_hashlife.c)
+void SimulateHashLife(int rank, int p, int num_iterations, const GolOptions* opts);
+
+// bit-packed engine (gol_packed.c)
+void SimulatePacked(int rank, int p, int num_iterations, const GolOptions* opts);
+
+// out-of-core engine (gol_ooc.c)
+void SimulateOutOfCore(int rank, int p, int num_iterations, const GolOptions* opts);
+
+#endif
@@ -0,0 +1,98 @@
+/*
+* Ethan Vincent
+* Board storage allocator: cache-line aligned heap blocks, or page-aligned
+* mappings backed by transparent or explicit huge pages
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+
+#include "gol.h"
+
+#define CACHE_LINE 64
+#define HUGE_PAGE (2*1024*1024)
+
+// page backing requested with --pages=, and what the last allocation actually got
+int PAGE_MODE = GOL_PAGES_DEFAULT;
+const char* page_mode_used = "default";
+
+static size_t RoundUp(size_t bytes, size_t to)
+{
+    return ((bytes + to - 1)/to)*to;
+}
+
+/*
+* Allocate bytes of board storage into block. Memory is not zeroed, so the
+* caller decides which thread touches each page first. Huge page requests
+* that the kernel cannot satisfy fall back to the next weaker mode.
+*/
+void* GolAlloc(GolBlock* block, size_t bytes)
+{
+    block->bytes = bytes;
+    block->mapped = 0;
+    block->ptr = NULL;
+
+#ifdef MAP_HUGETLB
+    if (PAGE_MODE == GOL_PAGES_HUGETLB)
+    {
+        size_t length = RoundUp(bytes, HUGE_PAGE);
+        void* ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED)
+        {
+            block->ptr = ptr;
+            block->bytes = length;
+            block->mapped = 1;
+            page_mode_used = "hugetlb";
+            return ptr;
+        }
+    }
+#endif
+
+    if (PAGE_MODE != GOL_PAGES_DEFAULT)
+    {
+        // page-aligned private mapping the kernel may back with transparent huge pages
+        size_t length = RoundUp(bytes, HUGE_PAGE);
+        void* ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr != MAP_FAILED)
+        {
+#ifdef MADV_HUGEPAGE
+            madvise(ptr, length, MADV_HUGEPAGE);
+#endif
+            block->ptr = ptr;
+            block->bytes = length;
+            block->mapped = 1;
+            page_mode_used = "thp";
+            return ptr;
+        }
+    }
+
+    if (posix_memalign(&block->ptr, CACHE_LINE, RoundUp(bytes, CACHE_LINE)) != 0)
+    {
+        printf("failed to allocate %zu bytes of board storage\n", bytes);
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+    page_mode_used = "default";
+    return block->ptr;
+}
+
+void GolFree(GolBlock* block)
+{
+    if (block->ptr == NULL)
+    {
+        return;
+    }
+
+    if (block->mapped)
+    {
+        munmap(block->ptr, block->bytes);
+    }
+    else
+    {
+        free(block->ptr);
+    }
+    block->ptr = NULL;
+    block->bytes = 0;
+}
@@ -0,0 +1,209 @@
+/*
+* Ethan Vincent
+* Dynamic load balancing for the grid engine: every few generations the
+* compute time of each process row is compared, and board rows migrate
+* across the band boundaries so slower bands own fewer rows
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+// bands this much slower than the mean trigger a migration
+#define BALANCE_THRESHOLD 1.05
+
+void BalanceCreate(GolBalance* balance, GolHalo* halo)
+{
+    balance->bands = halo->dims[0];
+    balance->starts = (int*)malloc(sizeof(int)*(balance->bands + 1));
+    for (int k = 0; k <= balance->bands; k++)
+    {
+        balance->starts[k] = k < balance->bands ? BlockStart(HEIGHT, balance->bands, k) : HEIGHT;
+    }
+
+    // procs in one process column trade rows with each other; rank = band index
+    MPI_Comm_split(halo->cart, halo->coords[1], halo->coords[0], &balance->column);
+
+    balance->window_start = TimingSum(TIMER_COMPUTE);
+    balance->checks = 0;
+    balance->rebalances = 0;
+    balance->rows_moved = 0.0;
+    balance->time = 0.0;
+    balance->imbalance = 1.0;
+}
+
+void BalanceFree(GolBalance* balance)
+{
+    free(balance->starts);
+    MPI_Comm_free(&balance->column);
+}
+
+/*
+* New band boundaries: each band's target share is proportional to its
+* measured speed (rows per second of compute), and bands move half way
+* to it so timer noise does not make rows bounce back and forth.
+*/
+static void Repartition(GolBalance* balance, const double* band_time, int min_rows, int* starts)
+{
+    int bands = balance->bands;
+    double total_speed = 0.0;
+    for (int k = 0; k < bands; k++)
+    {
+        int rows = balance->starts[k+1] - balance->starts[k];
+        total_speed += band_time[k] > 0.0 ? rows/band_time[k] : 0.0;
+    }
+
+    double edge = 0.0;
+    starts[0] = 0;
+    for (int k = 0; k < bands; k++)
+    {
+        int rows = balance->starts[k+1] - balance->starts[k];
+        double target = total_speed > 0.0 && band_time[k] > 0.0 ? HEIGHT*(rows/band_time[k])/total_speed : rows;
+        edge += rows + 0.5*(target - rows);
+        starts[k+1] = (int)(edge + 0.5);
+    }
+    starts[bands] = HEIGHT;
+
+    // every band keeps enough rows to fill its neighbors' ghost frames
+    for (int k = 1; k < bands; k++)
+    {
+        if (starts[k] < starts[k-1] + min_rows)
+        {
+            starts[k] = starts[k-1] + min_rows;
+        }
+    }
+    for (int k = bands - 1; k > 0; k--)
+    {
+        if (starts[k] > starts[k+1] - min_rows)
+        {
+            starts[k] = starts[k+1] - min_rows;
+        }
+    }
+}
+
+// rows [s0, s1) and [t0, t1) overlap in [*a, *b); returns the overlap length
+static int Overlap(int s0, int s1, int t0, int t1, int* a, int* b)
+{
+    *a = s0 > t0 ? s0 : t0;
+    *b = s1 < t1 ? s1 : t1;
+    return *b > *a ? *b - *a : 0;
+}
+
+/*
+* Move this proc's block to the rows [starts[band], starts[band+1]). Rows
+* are exchanged with Alltoallv inside the process column; boundaries move
+* only part way per balance point, so in practice rows only cross to the
+* neighboring band.
+*/
+static void Migrate(GolBalance* balance, GolGrid* grid, GolHalo* halo, const int* starts)
+{
+    int bands = balance->bands, band = halo->coords[0];
+    int cols = grid->cols;
+    int old0 = balance->starts[band], old1 = balance->starts[band+1];
+    int new0 = starts[band], new1 = starts[band+1];
+
+    int* send_counts = (int*)calloc(bands, sizeof(int));
+    int* send_displs = (int*)calloc(bands, sizeof(int));
+    int* recv_counts = (int*)calloc(bands, sizeof(int));
+    int* recv_displs = (int*)calloc(bands, sizeof(int));
+    for (int k = 0; k < bands; k++)
+    {
+        int a, b;
+        send_counts[k] = Overlap(old0, old1, starts[k], starts[k+1], &a, &b)*cols;
+        send_displs[k] = (a - old0)*cols;
+        recv_counts[k] = Overlap(new0, new1, balance->starts[k], balance->starts[k+1], &a, &b)*cols;
+        recv_displs[k] = (a - new0)*cols;
+        if (k != band)
+        {
+            balance->rows_moved += recv_counts[k]/cols;
+        }
+    }
+
+    uint8_t* send = (uint8_t*)malloc((size_t)(old1 - old0)*cols);
+    uint8_t* recv = (uint8_t*)malloc((size_t)(new1 - new0)*cols);
+    for (int i = 0; i < grid->rows; i++)
+    {
+        memcpy(&send[(size_t)i*cols], GridRow(grid, grid->cur, i), cols);
+    }
+    MPI_Alltoallv(send, send_counts, send_displs, MPI_UNSIGNED_CHAR,
+                  recv, recv_counts, recv_displs, MPI_UNSIGNED_CHAR, balance->column);
+
+    // rebuild the block at its new size; the halo types follow the new shape
+    int ghost = grid->ghost, col0 = grid->col0;
+    GridFree(grid);
+    GridCreate(grid, new1 - new0, cols, ghost);
+    grid->row0 = new0;
+    grid->col0 = col0;
+    GridFirstTouch(grid);
+    for (int i = 0; i < grid->rows; i++)
+    {
+        memcpy(GridRow(grid, grid->cur, i), &recv[(size_t)i*cols], cols);
+    }
+    HaloSetTypes(halo, grid);
+
+    free(send);
+    free(recv);
+    free(send_counts);
+    free(send_displs);
+    free(recv_counts);
+    free(recv_displs);
+}
+
+/*
+* Balance point (collective): compare the compute time each band spent
+* since the last one and migrate rows if the slowest band is more than
+* BALANCE_THRESHOLD over the mean. Returns 1 if the grid was rebuilt.
+*/
+int BalanceStep(GolBalance* balance, GolGrid* grid, GolHalo* halo, int min_rows)
+{
+    double start = MPI_Wtime();
+    int bands = balance->bands;
+    balance->checks++;
+
+    double now = TimingSum(TIMER_COMPUTE);
+    double window = now - balance->window_start;
+    balance->window_start = now;
+    if (bands == 1)
+    {
+        balance->time += MPI_Wtime() - start;
+        return 0;
+    }
+
+    // a band runs at the pace of its slowest proc
+    double* my_time = (double*)calloc(bands, sizeof(double));
+    double* band_time = (double*)malloc(sizeof(double)*bands);
+    my_time[halo->coords[0]] = window;
+    MPI_Allreduce(my_time, band_time, bands, MPI_DOUBLE, MPI_MAX, halo->cart);
+
+    double slowest = 0.0, mean = 0.0;
+    for (int k = 0; k < bands; k++)
+    {
+        slowest = band_time[k] > slowest ? band_time[k] : slowest;
+        mean += band_time[k]/bands;
+    }
+    balance->imbalance = mean > 0.0 ? slowest/mean : 1.0;
+
+    int moved = 0;
+    if (balance->imbalance > BALANCE_THRESHOLD)
+    {
+        int* starts = (int*)malloc(sizeof(int)*(bands + 1));
+        Repartition(balance, band_time, min_rows, starts);
+        if (memcmp(starts, balance->starts, sizeof(int)*(bands + 1)) != 0)
+        {
+            Migrate(balance, grid, halo, starts);
+            memcpy(balance->starts, starts, sizeof(int)*(bands + 1));
+            balance->rebalances++;
+            moved = 1;
+        }
+        free(starts);
+    }
+
+    free(my_time);
+    free(band_time);
+    balance->time += MPI_Wtime() - start;
+    return moved;
+}
@@ -0,0 +1,139 @@
+/*
+* Ethan Vincent
+* Steady-state and oscillator detection: one fingerprint of the whole
+* board per generation, summed over ranks, compared against the last K
+* so a run can stop as soon as the board repeats
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+// results for the metrics block
+int steady_generation = -1;
+int steady_period = 0;
+double* population_trajectory = NULL;
+int population_generations = 0;
+int population_first_generation = 0;
+
+// last max_period fingerprints, check hashes and populations, indexed by generation % max_period
+static int max_period = 0;
+static uint64_t* ring_hashes = NULL;
+static uint64_t* ring_checks = NULL;
+static uint64_t* ring_populations = NULL;
+
+void DetectCreate(int period, int start, int num_iterations)
+{
+    max_period = period;
+    population_first_generation = start;
+    ring_hashes = (uint64_t*)calloc(period, sizeof(uint64_t));
+    ring_checks = (uint64_t*)calloc(period, sizeof(uint64_t));
+    ring_populations = (uint64_t*)calloc(period, sizeof(uint64_t));
+
+    // one population per generation, including the starting board
+    population_trajectory = (double*)malloc(sizeof(double)*((num_iterations > start ? num_iterations - start : 0) + 1));
+    population_generations = 0;
+    steady_generation = -1;
+    steady_period = 0;
+}
+
+void DetectFree(void)
+{
+    free(ring_hashes);
+    free(ring_checks);
+    free(ring_populations);
+    ring_hashes = NULL;
+    ring_checks = NULL;
+    ring_populations = NULL;
+}
+
+static uint64_t Mix(uint64_t z)
+{
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// a second finalizer with unrelated constants, for the check hash
+static uint64_t MixCheck(uint64_t z)
+{
+    z = (z ^ (z >> 33))*0xFF51AFD7ED558CCDULL;
+    z = (z ^ (z >> 33))*0xC4CEB9FE1A85EC53ULL;
+    return z ^ (z >> 33);
+}
+
+/*
+* Add the fingerprint of n bytes of cells at a fixed place on the board
+* (key) to hash and check. Every eight-cell word is mixed with its own
+* position before it is summed, so moving live cells around a row changes
+* the result; a plain sum of words would not. check uses an independent
+* mix and position key, and a repeat only counts when both agree. Ranks
+* add up the fingerprints of their pieces, so the board's fingerprint does
+* not depend on the order pieces are visited in or on which rank owns a
+* row.
+*/
+void HashCells(const uint8_t* cells, size_t n, uint64_t key, uint64_t* hash, uint64_t* check)
+{
+    uint64_t h = 0, c = 0;
+    uint64_t hash_key = Mix(key + 0x9E3779B97F4A7C15ULL);
+    uint64_t check_key = MixCheck(key ^ 0xD6E8FEB86659FD93ULL);
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8)
+    {
+        uint64_t word;
+        memcpy(&word, cells + j, 8);
+        h += Mix(word ^ (hash_key + j*0x9E3779B97F4A7C15ULL));
+        c += MixCheck(word + (check_key ^ j*0xA0761D6478BD642FULL));
+    }
+    if (j < n)
+    {
+        uint64_t word = 0;
+        memcpy(&word, cells + j, n - j);
+        h += Mix(word ^ (hash_key + j*0x9E3779B97F4A7C15ULL));
+        c += MixCheck(word + (check_key ^ j*0xA0761D6478BD642FULL));
+    }
+    *hash += h;
+    *check += c;
+}
+
+/*
+* Record this generation's board (collective). hash, check and population
+* are this rank's share; the global values are compared with the last
+* max_period generations. Returns the period (1 for a still life) if the
+* board repeats one of them, otherwise 0. Every rank gets the same answer.
+*/
+int DetectStep(uint64_t hash, uint64_t check, uint64_t population, int generation)
+{
+    uint64_t local[3] = {hash, check, population}, global[3];
+    MPI_Allreduce(local, global, 3, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    population_trajectory[population_generations++] = (double)global[2];
+
+    // nearest earlier generation first, so the period found is the smallest
+    int period = 0;
+    for (int d = 1; d <= max_period && generation - d >= population_first_generation; d++)
+    {
+        int slot = (generation - d) % max_period;
+        if (ring_hashes[slot] == global[0] && ring_checks[slot] == global[1] && ring_populations[slot] == global[2])
+        {
+            period = d;
+            break;
+        }
+    }
+
+    int slot = generation % max_period;
+    ring_hashes[slot] = global[0];
+    ring_checks[slot] = global[1];
+    ring_populations[slot] = global[2];
+
+    if (period > 0)
+    {
+        steady_generation = generation;
+        steady_period = period;
+    }
+    return period;
+}
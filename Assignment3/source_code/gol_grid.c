@@ -0,0 +1,528 @@
+/*
+* Ethan Vincent
+* Ghost-padded, double-buffered Game of Life engine
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+// pad every row out to a 64 byte multiple so rows start cache-line aligned
+int GridStride(int cols, int ghost)
+{
+    return ((cols + 2*ghost + 63)/64)*64;
+}
+
+void GridCreate(GolGrid* grid, int rows, int cols, int ghost)
+{
+    grid->rows = rows;
+    grid->cols = cols;
+    grid->row0 = 0;
+    grid->col0 = 0;
+    grid->ghost = ghost;
+
+    grid->stride = GridStride(cols, ghost);
+    grid->plane = (size_t)(rows + 2*ghost)*grid->stride;
+
+    // pages are left untouched here; GridFirstTouch places them
+    grid->cur = (uint8_t*)GolAlloc(&grid->storage, 2*grid->plane);
+    grid->next = grid->cur + grid->plane;
+}
+
+// size the grid to this proc's block of the HEIGHT x WIDTH board
+void GridCreateBlock(GolGrid* grid, GolHalo* halo, int ghost)
+{
+    GridCreate(grid, BlockSize(HEIGHT, halo->dims[0], halo->coords[0]),
+               BlockSize(WIDTH, halo->dims[1], halo->coords[1]), ghost);
+    grid->row0 = BlockStart(HEIGHT, halo->dims[0], halo->coords[0]);
+    grid->col0 = BlockStart(WIDTH, halo->dims[1], halo->coords[1]);
+}
+
+/*
+* Zero both boards with the same static row split the kernel uses, so on a
+* NUMA node each row's pages land next to the thread that will update it.
+*/
+void GridFirstTouch(GolGrid* grid)
+{
+    int padded_rows = grid->rows + 2*grid->ghost;
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < padded_rows; i++)
+    {
+        memset(grid->cur + (size_t)i*grid->stride, 0, grid->stride);
+        memset(grid->next + (size_t)i*grid->stride, 0, grid->stride);
+    }
+}
+
+void GridFree(GolGrid* grid)
+{
+    GolFree(&grid->storage);
+    grid->cur = grid->next = NULL;
+}
+
+void GenerateInitialGrid(GolGrid* grid)
+{
+    GridFirstTouch(grid);
+
+    // counter-based cells, so rows fill in parallel and match any other decomposition
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < grid->rows; i++)
+    {
+        InitialRow(grid->row0 + i, grid->col0, grid->cols, GridRow(grid, grid->cur, i));
+    }
+}
+
+void PrintBoardGrid(GolGrid* grid, GolHalo* halo, int rank, int p)
+{
+    int rows = grid->rows;
+    int cols = grid->cols;
+
+    // every proc sends its owned block (without the ghost frame) to p0
+    uint8_t* block = (uint8_t*)malloc((size_t)rows*cols);
+    for (int i = 0; i < rows; i++)
+    {
+        memcpy(&block[(size_t)i*cols], GridRow(grid, grid->cur, i), cols);
+    }
+
+    // block shapes vary once the load balancer has moved rows, so each one travels with its extent
+    int extent[4] = {grid->row0, rows, grid->col0, cols};
+    if (rank != 0)
+    {
+        MPI_Send(extent, 4, MPI_INT, 0, 1, halo->cart);
+        MPI_Send(block, rows*cols, MPI_UNSIGNED_CHAR, 0, 0, halo->cart);
+    }
+    else
+    {
+        // p0 places every block into the full board, then prints it
+        uint8_t* board = (uint8_t*)malloc((size_t)HEIGHT*WIDTH);
+        for (int i = 0; i < p; i++)
+        {
+            uint8_t* src = block;
+            if (i != 0)
+            {
+                MPI_Recv(extent, 4, MPI_INT, i, 1, halo->cart, MPI_STATUS_IGNORE);
+                src = (uint8_t*)malloc((size_t)extent[1]*extent[3]);
+                MPI_Recv(src, extent[1]*extent[3], MPI_UNSIGNED_CHAR, i, 0, halo->cart, MPI_STATUS_IGNORE);
+            }
+            for (int j = 0; j < extent[1]; j++)
+            {
+                memcpy(&board[(size_t)(extent[0] + j)*WIDTH + extent[2]], &src[(size_t)j*extent[3]], extent[3]);
+            }
+            if (src != block)
+            {
+                free(src);
+            }
+        }
+
+        for (int j = 0; j < HEIGHT; j++)
+        {
+            for (int k = 0; k < WIDTH; k++)
+            {
+                printf("%d ", board[(size_t)j*WIDTH + k]);
+            }
+            printf("\n");
+        }
+        printf("\n");
+        free(board);
+    }
+    free(block);
+}
+
+// row kernel chosen at startup by SelectRowKernel
+static GolRowKernel step_row = NULL;
+
+// compute cells [r0, r1) x [c0, c1) of the next generation
+void GridStepRegion(GolGrid* grid, int r0, int r1, int c0, int c1)
+{
+    if (RULE.radius > 1)
+    {
+        LtlStepRegion(grid, r0, r1, c0, c1);
+        return;
+    }
+
+    // rows are independent, so the worker threads split them statically
+    #pragma omp parallel for schedule(static) if (r1 - r0 > 8)
+    for (int x = r0; x < r1; x++)
+    {
+        step_row(GridRow(grid, grid->cur, x-1) + c0, GridRow(grid, grid->cur, x) + c0, GridRow(grid, grid->cur, x+1) + c0,
+                GridRow(grid, grid->next, x) + c0, c1 - c0);
+    }
+}
+
+// compute the frame between outer [r0, r1) x [c0, c1) and inner [ir0, ir1) x [ic0, ic1)
+static void StepFrame(GolGrid* grid, int r0, int r1, int c0, int c1, int ir0, int ir1, int ic0, int ic1)
+{
+    GridStepRegion(grid, r0, ir0, c0, c1);
+    GridStepRegion(grid, ir1, r1, c0, c1);
+    GridStepRegion(grid, ir0, ir1, c0, ic0);
+    GridStepRegion(grid, ir0, ir1, ic1, c1);
+}
+
+/*
+* Temporal blocking: advance all steps of a halo batch in one pass down
+* the block. Wave k computes, for each step s in turn, the b rows starting
+* at lo + k*b - s*radius, so step s trails step s-1 by one stencil radius:
+* the rows it reads are already done, and the rows step s+1 writes over
+* step s-1's board (the two boards alternate) are ones step s no longer
+* needs. Only about steps*(b+radius) rows of each board are live at once,
+* so they stay in cache between steps instead of every generation
+* streaming the whole block.
+*/
+static void StepWavefront(GolGrid* grid, int steps, int b, int radius)
+{
+    int rows = grid->rows, cols = grid->cols;
+    int lo = -(steps - 1)*radius;
+    uint8_t* planes[2] = {grid->cur, grid->next};
+
+    for (int k = 0, done = 0; !done; k++)
+    {
+        done = 1;
+        for (int s = 0; s < steps; s++)
+        {
+            // step s covers the ghost frame out to e cells, like the sweep does
+            int e = (steps - 1 - s)*radius;
+            int r0 = lo + k*b - s*radius, r1 = r0 + b;
+            if (r1 < rows + e)
+            {
+                done = 0;
+            }
+            r0 = r0 > -e ? r0 : -e;
+            r1 = r1 < rows + e ? r1 : rows + e;
+            if (r0 < r1)
+            {
+                grid->cur = planes[s & 1];
+                grid->next = planes[(s + 1) & 1];
+                GridStepRegion(grid, r0, r1, -e, cols + e);
+            }
+        }
+    }
+
+    grid->cur = planes[steps & 1];
+    grid->next = planes[(steps + 1) & 1];
+}
+
+// this proc's share of the board fingerprint, check hash and live cells (owned block only)
+static void GridFingerprint(GolGrid* grid, uint64_t* hash, uint64_t* check, uint64_t* population)
+{
+    uint64_t h = 0, c = 0, live = 0;
+
+    #pragma omp parallel for schedule(static) reduction(+:h, c, live)
+    for (int i = 0; i < grid->rows; i++)
+    {
+        uint8_t* row = GridRow(grid, grid->cur, i);
+        HashCells(row, grid->cols, (uint64_t)(grid->row0 + i) << 32 | (uint32_t)grid->col0, &h, &c);
+        for (int j = 0; j < grid->cols; j++)
+        {
+            live += row[j];
+        }
+    }
+    *hash = h;
+    *check = c;
+    *population = live;
+}
+
+// record generation's board; nonzero once it repeats a recent one (collective)
+static int GridDetect(GolGrid* grid, int generation)
+{
+    uint64_t hash, check, population;
+    GridFingerprint(grid, &hash, &check, &population);
+    return DetectStep(hash, check, population, generation);
+}
+
+static void SwapBoards(GolGrid* grid)
+{
+    uint8_t* tmp = grid->cur;
+    grid->cur = grid->next;
+    grid->next = tmp;
+}
+
+void SimulateGrid(int rank, int p, int num_iterations, const GolOptions* opts)
+{
+    GolHalo halo;
+    HaloCreate(&halo, opts, p);
+
+    // every block needs at least one ghost frame of owned cells to send; a
+    // radius r stencil uses up r ghost cells per generation
+    int depth = opts->halo_depth;
+    int radius = RULE.radius;
+    if (HEIGHT/halo.dims[0] < depth*radius || WIDTH/halo.dims[1] < depth*radius)
+    {
+        if (rank == 0)
+        {
+            printf("board_size %d is too small for a %dx%d process grid with halo depth %d and radius %d\n",
+                   HEIGHT, halo.dims[0], halo.dims[1], depth, radius);
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    // a ghost frame k cells deep lets each exchange cover k generations
+    GolGrid grid;
+    GridCreateBlock(&grid, &halo, depth*radius);
+    if (radius > 1)
+    {
+        // no region reaches past the ghost frame, so a padded row holds any region's column sums
+        LtlCreate(grid.stride, opts->threads);
+    }
+    if (opts->halo_transport == GOL_HALO_SHM)
+    {
+        HaloShareGrid(&halo, &grid);
+    }
+    else if (opts->halo_transport == GOL_HALO_RMA)
+    {
+        HaloExposeGrid(&halo, &grid);
+    }
+    // active tiles vary the send counts per generation, so they post fresh requests; puts need none
+    halo.persistent = opts->tile_size == 0 && opts->halo_transport != GOL_HALO_RMA;
+    HaloSetTypes(&halo, &grid);
+
+    int g = grid.ghost;
+    board_bytes_per_proc = 2.0*grid.plane;
+    halo_bytes_per_generation = (2.0*g*(grid.rows + grid.cols) + 4.0*g*g)/depth;
+
+    // a restart resumes at the snapshot's generation and runs up to num_iterations
+    int start = 0;
+    if (opts->restart != NULL)
+    {
+        GridFirstTouch(&grid);
+        start = (int)ReadSnapshot(opts->restart, &grid, &halo);
+    }
+    else
+    {
+        GenerateInitialGrid(&grid);
+    }
+
+    step_row = SelectRowKernel(opts->kernel, &kernel_name);
+
+    GolBalance balance;
+    BalanceCreate(&balance, &halo);
+
+    // estimated board traffic, against the cache one proc can count on
+    double sweep_bytes = 0.0, temporal_bytes = 0.0;
+    long cache_bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    cache_bytes = cache_bytes > 0 ? cache_bytes : 1L << 20;
+
+    // the final board is num_iterations unless the run settles into a cycle first
+    int end = num_iterations > start ? num_iterations : start;
+    int stop = 0;
+    if (opts->detect_period > 0)
+    {
+        DetectCreate(opts->detect_period, start, num_iterations);
+        GridDetect(&grid, start);
+    }
+
+    GolTiles tiles;
+    tiles.size = 0;
+    if (opts->tile_size > 0)
+    {
+        TilesCreate(&tiles, &grid, opts->tile_size);
+    }
+
+    for (int i = start; i < num_iterations; i += depth)
+    {
+        // the halo receives already order each block after its neighbors, so a
+        // global barrier only makes every proc wait for the slowest one
+        TimingBeginGeneration();
+        if (GENERATION_BARRIER)
+        {
+            double barrier_start = MPI_Wtime();
+            MPI_Barrier(MPI_COMM_WORLD);
+            TimingAdd(TIMER_BARRIER, MPI_Wtime() - barrier_start);
+        }
+
+        // step 0 reaches e cells into the ghost frame, each later step one less,
+        // so the last step of the batch lands exactly on the owned block
+        int steps = (num_iterations - i < depth) ? num_iterations - i : depth;
+        int e = (steps - 1)*radius;
+        int rows = grid.rows, cols = grid.cols;
+
+        if (tiles.size > 0)
+        {
+            // resend changed edges only, then recompute tiles near a change
+            TilesStep(&tiles, &grid, &halo);
+        }
+        else if (opts->overlap && rows > 2*radius && cols > 2*radius)
+        {
+            // post the exchange, then update the cells that need no ghost data
+            double comm_start = MPI_Wtime();
+            HaloBegin(&halo, &grid);
+            double interior_start = MPI_Wtime();
+
+            GridStepRegion(&grid, radius, rows - radius, radius, cols - radius);
+
+            // finish the exchange and the rest of step 0 that depends on it
+            double wait_start = MPI_Wtime();
+            HaloEnd(&halo, &grid);
+            double comm_end = MPI_Wtime();
+
+            total_comm_time += (interior_start - comm_start) + (comm_end - wait_start);
+            overlap_window_time += wait_start - interior_start;
+
+            StepFrame(&grid, -e, rows + e, -e, cols + e, radius, rows - radius, radius, cols - radius);
+
+            TimingAdd(TIMER_PACK, interior_start - comm_start);
+            TimingAdd(TIMER_WAIT, comm_end - wait_start);
+            TimingAdd(TIMER_COMPUTE, (wait_start - interior_start) + (MPI_Wtime() - comm_end));
+        }
+        else
+        {
+            // fill the ghost frame from the neighboring blocks
+            double comm_start = MPI_Wtime();
+            HaloBegin(&halo, &grid);
+            double wait_start = MPI_Wtime();
+            HaloEnd(&halo, &grid);
+            double comm_end = MPI_Wtime();
+            total_comm_time += comm_end - comm_start;
+
+            if (opts->temporal_rows > 0)
+            {
+                StepWavefront(&grid, steps, opts->temporal_rows, radius);
+            }
+            else
+            {
+                GridStepRegion(&grid, -e, rows + e, -e, cols + e);
+            }
+
+            TimingAdd(TIMER_PACK, wait_start - comm_start);
+            TimingAdd(TIMER_WAIT, comm_end - wait_start);
+            TimingAdd(TIMER_COMPUTE, MPI_Wtime() - comm_end);
+        }
+        halo_exchanges++;
+
+        int advanced = steps;
+        if (opts->temporal_rows > 0)
+        {
+            // the wavefront already left the board at the end of the batch
+            TimingEndGenerations(steps);
+        }
+        else
+        {
+            SwapBoards(&grid);
+            TimingEndGeneration();
+
+            // the owned block is a finished generation after every step, even mid-batch
+            advanced = 1;
+            stop = opts->detect_period > 0 && GridDetect(&grid, i + 1);
+
+            // advance the rest of the batch locally on the shrinking ghost region
+            for (int s = 1; s < steps && !stop; s++)
+            {
+                e = (steps - 1 - s)*radius;
+                double compute_start = MPI_Wtime();
+                GridStepRegion(&grid, -e, rows + e, -e, cols + e);
+                SwapBoards(&grid);
+                TimingAdd(TIMER_COMPUTE, MPI_Wtime() - compute_start);
+                TimingEndGeneration();
+
+                advanced++;
+                stop = opts->detect_period > 0 && GridDetect(&grid, i + s + 1);
+            }
+        }
+
+        // every step beyond the owned block is redundant work shared with a neighbor;
+        // a sweep reads and writes every cell it updates once per step
+        double batch_bytes = 0.0;
+        for (int s = 0; s < advanced; s++)
+        {
+            e = (steps - 1 - s)*radius;
+            redundant_cell_updates += (double)(rows + 2*e)*(cols + 2*e) - (double)rows*cols;
+            batch_bytes += 2.0*(rows + 2*e)*(cols + 2*e);
+        }
+        owned_cell_updates += (double)advanced*rows*cols;
+        sweep_bytes += batch_bytes;
+
+        // the wavefront streams the batch once if its live rows fit in cache
+        if (opts->temporal_rows > 0)
+        {
+            int reach = (steps - 1)*radius;
+            temporal_working_set = 2.0*((double)steps*(opts->temporal_rows + radius) + 2*radius)*grid.stride;
+            temporal_bytes += temporal_working_set <= cache_bytes ?
+                              2.0*(rows + 2*reach)*(cols + 2*reach) : batch_bytes;
+        }
+
+        if (__DEBUG__)
+        {
+            printf("Process %d has finished grid iterations %d-%d\n", rank, i, i + advanced - 1);
+        }
+
+        // the board repeats from here on, so the remaining generations change nothing new
+        if (stop)
+        {
+            end = i + advanced;
+            break;
+        }
+
+        // move rows between process rows whenever a batch crosses a multiple of balance_every
+        if (opts->balance_every > 0 && (i + steps)/opts->balance_every > i/opts->balance_every &&
+            i + steps < num_iterations && BalanceStep(&balance, &grid, &halo, g))
+        {
+            board_bytes_per_proc = 2.0*grid.plane;
+            halo_bytes_per_generation = (2.0*g*(grid.rows + grid.cols) + 4.0*g*g)/depth;
+            if (tiles.size > 0)
+            {
+                TilesFree(&tiles);
+                TilesCreate(&tiles, &grid, opts->tile_size);
+            }
+        }
+
+        // checkpoint whenever a batch crosses a multiple of checkpoint_every
+        if (opts->checkpoint_every > 0 && (i + steps)/opts->checkpoint_every > i/opts->checkpoint_every)
+        {
+            WriteSnapshot(opts->checkpoint_file, &grid, &halo, i + steps);
+        }
+    }
+
+    if (tiles.size > 0)
+    {
+        double counts[4] = {tiles.tiles_updated, tiles.tiles_total, tiles.edges_skipped, tiles.edges_total};
+        MPI_Allreduce(MPI_IN_PLACE, counts, 4, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        tile_update_fraction = counts[1] > 0 ? counts[0]/counts[1] : 0.0;
+        halo_edge_skip_fraction = counts[3] > 0 ? counts[2]/counts[3] : 0.0;
+        TilesFree(&tiles);
+    }
+
+    if (end > start)
+    {
+        sweep_bytes_per_generation = sweep_bytes/(end - start);
+        temporal_bytes_per_generation = temporal_bytes/(end - start);
+    }
+    if (opts->detect_period > 0)
+    {
+        DetectFree();
+    }
+
+    // final layout for the metrics block
+    balance_checks = balance.checks;
+    balance_rebalances = balance.rebalances;
+    balance_rows_moved = balance.rows_moved;
+    balance_time = balance.time;
+    balance_imbalance = balance.imbalance;
+    int length = 0;
+    for (int k = 0; k < balance.bands && length < (int)sizeof(balance_layout) - 16; k++)
+    {
+        length += snprintf(balance_layout + length, sizeof(balance_layout) - length, "%s%d", k ? " " : "",
+                           balance.starts[k+1] - balance.starts[k]);
+    }
+    BalanceFree(&balance);
+
+    if (opts->snapshot != NULL)
+    {
+        WriteSnapshot(opts->snapshot, &grid, &halo, end);
+    }
+
+    if (opts->print_board)
+    {
+        PrintBoardGrid(&grid, &halo, rank, p);
+    }
+
+    if (radius > 1)
+    {
+        LtlFree();
+    }
+    GridFree(&grid);
+    HaloFree(&halo);
+}
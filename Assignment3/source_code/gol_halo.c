@@ -0,0 +1,308 @@
+/*
+* Ethan Vincent
+* 2D block decomposition and halo exchange for the grid engine
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+// (row, column) offset of each neighbor; opposite directions sum to 7
+const int HALO_OFFSETS[HALO_DIRECTIONS][2] =
+{
+    {-1, -1}, {-1, 0}, {-1, 1},
+    { 0, -1},          { 0, 1},
+    { 1, -1}, { 1, 0}, { 1, 1}
+};
+
+// rows (or columns) given to block i when n are split over parts blocks;
+// the first n % parts blocks take one extra
+int BlockSize(int n, int parts, int i)
+{
+    return n/parts + (i < n % parts ? 1 : 0);
+}
+
+int BlockStart(int n, int parts, int i)
+{
+    return i*(n/parts) + (i < n % parts ? i : n % parts);
+}
+
+void HaloCreate(GolHalo* halo, const GolOptions* opts, int p)
+{
+    // honor a requested process grid, otherwise let MPI balance the factors
+    halo->dims[0] = opts->proc_rows;
+    halo->dims[1] = opts->proc_cols;
+    MPI_Dims_create(p, 2, halo->dims);
+
+    // the board is a torus, so both dimensions wrap; keep world ranks as they are
+    int periods[2] = {1, 1};
+    MPI_Cart_create(MPI_COMM_WORLD, 2, halo->dims, periods, 0, &halo->cart);
+
+    int rank;
+    MPI_Comm_rank(halo->cart, &rank);
+    MPI_Cart_coords(halo->cart, rank, 2, halo->coords);
+
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        int coords[2] = {halo->coords[0] + HALO_OFFSETS[d][0], halo->coords[1] + HALO_OFFSETS[d][1]};
+        MPI_Cart_rank(halo->cart, coords, &halo->neighbors[d]);
+    }
+
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        halo->send_types[d] = MPI_DATATYPE_NULL;
+        halo->recv_types[d] = MPI_DATATYPE_NULL;
+        halo->send_counts[d] = 1;
+    }
+    halo->persistent = 0;
+    halo->persistent_base = NULL;
+    halo->persistent_count = 0;
+    halo->active = halo->requests;
+    halo->active_count = 0;
+
+    // every edge is messaged until HaloShareGrid finds neighbors on this node
+    halo->transport = opts->halo_transport;
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        halo->node_ranks[d] = MPI_UNDEFINED;
+        halo->shm_neighbors[d] = NULL;
+    }
+    halo->node = MPI_COMM_NULL;
+    halo->window = MPI_WIN_NULL;
+    halo->window_base = NULL;
+    halo->neighbor_group = MPI_GROUP_NULL;
+    halo->shm_header = NULL;
+    halo->epoch = 0;
+}
+
+// start of the owned (ghost = 0) or ghost (ghost = 1) span along one axis
+// for a neighbor offset of -1, 0 or +1
+static void HaloSpan(int offset, int n, int g, int ghost, int* start, int* size)
+{
+    if (offset == 0)
+    {
+        *start = g;
+        *size = n;
+    }
+    else if (offset < 0)
+    {
+        *start = ghost ? 0 : g;
+        *size = g;
+    }
+    else
+    {
+        *start = ghost ? g + n : n;
+        *size = g;
+    }
+}
+
+// owned-coordinate rectangle [r0, r1) x [c0, c1) of the edge sent (ghost = 0)
+// or the ghost region received (ghost = 1) in direction d
+void HaloRegion(GolGrid* grid, int d, int ghost, int* r0, int* r1, int* c0, int* c1)
+{
+    int g = grid->ghost;
+    int rows, cols;
+    HaloSpan(HALO_OFFSETS[d][0], grid->rows, g, ghost, r0, &rows);
+    HaloSpan(HALO_OFFSETS[d][1], grid->cols, g, ghost, c0, &cols);
+    *r0 -= g;
+    *c0 -= g;
+    *r1 = *r0 + rows;
+    *c1 = *c0 + cols;
+}
+
+static void HaloPersistentFree(GolHalo* halo)
+{
+    if (halo->persistent_base == NULL)
+    {
+        return;
+    }
+    for (int b = 0; b < 2; b++)
+    {
+        for (int r = 0; r < halo->persistent_count; r++)
+        {
+            MPI_Request_free(&halo->persistent_requests[b][r]);
+        }
+    }
+    halo->persistent_base = NULL;
+}
+
+/*
+* The sixteen sends and receives never change between generations except
+* for the board they point at, which alternates between the two planes.
+* Build them once per plane with MPI_Send_init/MPI_Recv_init so each
+* exchange is a single MPI_Startall with no per-call argument checking or
+* datatype lookup.
+*/
+static void HaloPersistentCreate(GolHalo* halo, GolGrid* grid)
+{
+    HaloPersistentFree(halo);
+    halo->persistent_base = grid->cur < grid->next ? grid->cur : grid->next;
+
+    // edges read through shared memory get no request
+    for (int b = 0; b < 2; b++)
+    {
+        uint8_t* board = halo->persistent_base + b*grid->plane;
+        int n = 0;
+        for (int d = 0; d < HALO_DIRECTIONS; d++)
+        {
+            if (halo->node_ranks[d] == MPI_UNDEFINED)
+            {
+                MPI_Recv_init(board, 1, halo->recv_types[d], halo->neighbors[d], HALO_DIRECTIONS-1-d, halo->cart, &halo->persistent_requests[b][n++]);
+            }
+        }
+        for (int d = 0; d < HALO_DIRECTIONS; d++)
+        {
+            if (halo->node_ranks[d] == MPI_UNDEFINED)
+            {
+                MPI_Send_init(board, 1, halo->send_types[d], halo->neighbors[d], d, halo->cart, &halo->persistent_requests[b][n++]);
+            }
+        }
+        halo->persistent_count = n;
+    }
+}
+
+/*
+* Committed subarray type, over a padded rows x cols block with the given
+* ghost depth and stride, of the owned edge (recv = 0) that the neighbor
+* in direction d needs, or of the ghost region (recv = 1) it fills.
+*/
+void HaloSubarray(int rows, int cols, int ghost, int stride, int d, int recv, MPI_Datatype* type)
+{
+    int sizes[2] = {rows + 2*ghost, stride};
+    int subsizes[2], starts[2];
+    HaloSpan(HALO_OFFSETS[d][0], rows, ghost, recv, &starts[0], &subsizes[0]);
+    HaloSpan(HALO_OFFSETS[d][1], cols, ghost, recv, &starts[1], &subsizes[1]);
+    MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_UNSIGNED_CHAR, type);
+    MPI_Type_commit(type);
+}
+
+/*
+* Build a subarray type per direction over the padded board: the owned edge
+* (a row band, a column band or a corner) that the neighbor in that
+* direction needs, and the ghost region that neighbor fills in return.
+*/
+void HaloSetTypes(GolHalo* halo, GolGrid* grid)
+{
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        if (halo->send_types[d] != MPI_DATATYPE_NULL)
+        {
+            MPI_Type_free(&halo->send_types[d]);
+            MPI_Type_free(&halo->recv_types[d]);
+        }
+        HaloSubarray(grid->rows, grid->cols, grid->ghost, grid->stride, d, 0, &halo->send_types[d]);
+        HaloSubarray(grid->rows, grid->cols, grid->ghost, grid->stride, d, 1, &halo->recv_types[d]);
+    }
+
+    // requests hold the board address, so they follow every rebuilt grid
+    if (halo->persistent)
+    {
+        HaloPersistentCreate(halo, grid);
+    }
+}
+
+void HaloFree(GolHalo* halo)
+{
+    HaloPersistentFree(halo);
+    if (halo->window != MPI_WIN_NULL && halo->transport == GOL_HALO_SHM)
+    {
+        HaloSharedFree(halo);
+    }
+    else if (halo->window != MPI_WIN_NULL)
+    {
+        HaloExposeFree(halo);
+    }
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        if (halo->send_types[d] != MPI_DATATYPE_NULL)
+        {
+            MPI_Type_free(&halo->send_types[d]);
+            MPI_Type_free(&halo->recv_types[d]);
+        }
+    }
+    MPI_Comm_free(&halo->cart);
+}
+
+// post all eight receives into the ghost frame and all eight edge sends;
+// edges shared with procs on this node are published instead, and the
+// RMA transport puts every edge
+void HaloBegin(GolHalo* halo, GolGrid* grid)
+{
+    // the RMA transport puts every edge; the others message only the off-node ones
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        if (halo->transport == GOL_HALO_RMA || halo->node_ranks[d] == MPI_UNDEFINED)
+        {
+            halo_messages++;
+        }
+        else
+        {
+            halo_shared_edges++;
+        }
+    }
+
+    if (halo->transport == GOL_HALO_RMA)
+    {
+        HaloPutBegin(halo, grid);
+        return;
+    }
+    if (halo->window != MPI_WIN_NULL)
+    {
+        HaloSharedPublish(halo, grid);
+    }
+
+    if (halo->persistent_base != NULL)
+    {
+        halo->active = halo->persistent_requests[grid->cur == halo->persistent_base ? 0 : 1];
+        halo->active_count = halo->persistent_count;
+        if (halo->active_count > 0)
+        {
+            MPI_Startall(halo->active_count, halo->active);
+        }
+        return;
+    }
+
+    // with every edge messaged, request d is the receive from direction d
+    int n = 0;
+    halo->active = halo->requests;
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        if (halo->node_ranks[d] == MPI_UNDEFINED)
+        {
+            // the neighbor in direction d sees us in direction 7 - d and tags with that
+            MPI_Irecv(grid->cur, 1, halo->recv_types[d], halo->neighbors[d], HALO_DIRECTIONS-1-d, halo->cart, &halo->requests[n++]);
+        }
+    }
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        if (halo->node_ranks[d] == MPI_UNDEFINED)
+        {
+            // a count of 0 tells the neighbor this edge is unchanged (active tiles)
+            MPI_Isend(grid->cur, halo->send_counts[d], halo->send_types[d], halo->neighbors[d], d, halo->cart, &halo->requests[n++]);
+        }
+    }
+    halo->active_count = n;
+}
+
+void HaloEnd(GolHalo* halo, GolGrid* grid)
+{
+    if (halo->transport == GOL_HALO_RMA)
+    {
+        HaloPutEnd(halo);
+        return;
+    }
+
+    // same-node ghost cells are copied while the messages are in flight
+    if (halo->window != MPI_WIN_NULL)
+    {
+        HaloSharedCopy(halo, grid);
+    }
+    MPI_Waitall(halo->active_count, halo->active, halo->statuses);
+    if (halo->window != MPI_WIN_NULL)
+    {
+        HaloSharedDone(halo);
+    }
+}
@@ -0,0 +1,448 @@
+/*
+* Ethan Vincent
+* HashLife engine: the board is a hash-consed quadtree and each macro-cell
+* remembers its future, so a run can jump 2^k generations in one step
+*
+* The board is a torus of side N = 2^n. Tiling the root four times gives a
+* level n+1 node whose centre, advanced up to 2^(n-1) generations, is the
+* whole torus again shifted by N/2; that shift is tracked in an offset.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+typedef struct
+{
+    uint32_t nw, ne, sw, se;    // children, or 0/1 for a dead/alive cell at level 0
+    uint32_t next;              // next node in the same hash bucket
+    uint32_t level;             // side length is 2^level
+    uint64_t population;
+} HashNode;
+
+// memoized result of advancing node by 2^j generations
+typedef struct
+{
+    uint32_t node;
+    uint32_t j;
+    uint32_t result;
+} HashMemo;
+
+static HashNode* nodes = NULL;
+static uint32_t node_count = 0;
+static uint32_t node_capacity = 0;
+
+static uint32_t* buckets = NULL;
+static uint32_t bucket_count = 0;
+
+static HashMemo* memo = NULL;
+static uint32_t memo_count = 0;
+
+// stats for the metrics block
+static double memo_hits = 0.0;
+static double memo_misses = 0.0;
+static int collections = 0;
+static uint32_t peak_nodes = 0;
+
+#define NO_NODE 0xffffffffu
+
+static inline uint64_t HashChildren(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se)
+{
+    uint64_t h = nw*0x9e3779b97f4a7c15ULL;
+    h = (h ^ ne)*0xbf58476d1ce4e5b9ULL;
+    h = (h ^ sw)*0x94d049bb133111ebULL;
+    h = (h ^ se)*0x9e3779b97f4a7c15ULL;
+    return h ^ (h >> 31);
+}
+
+static void Rehash(uint32_t new_bucket_count)
+{
+    free(buckets);
+    bucket_count = new_bucket_count;
+    buckets = (uint32_t*)malloc(sizeof(uint32_t)*bucket_count);
+    memset(buckets, 0xff, sizeof(uint32_t)*bucket_count);
+
+    // the two level-0 cells are never hashed
+    for (uint32_t i = 2; i < node_count; i++)
+    {
+        HashNode* n = &nodes[i];
+        uint32_t b = HashChildren(n->nw, n->ne, n->sw, n->se) & (bucket_count - 1);
+        n->next = buckets[b];
+        buckets[b] = i;
+    }
+}
+
+// canonical node with the given children: every distinct square exists once
+static uint32_t Join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se)
+{
+    uint32_t b = HashChildren(nw, ne, sw, se) & (bucket_count - 1);
+    for (uint32_t i = buckets[b]; i != NO_NODE; i = nodes[i].next)
+    {
+        HashNode* n = &nodes[i];
+        if (n->nw == nw && n->ne == ne && n->sw == sw && n->se == se)
+        {
+            return i;
+        }
+    }
+
+    if (node_count == node_capacity)
+    {
+        node_capacity *= 2;
+        nodes = (HashNode*)realloc(nodes, sizeof(HashNode)*node_capacity);
+    }
+
+    uint32_t i = node_count++;
+    HashNode* n = &nodes[i];
+    n->nw = nw;
+    n->ne = ne;
+    n->sw = sw;
+    n->se = se;
+    n->level = nodes[nw].level + 1;
+    n->population = nodes[nw].population + nodes[ne].population + nodes[sw].population + nodes[se].population;
+    n->next = buckets[b];
+    buckets[b] = i;
+
+    if (node_count > peak_nodes)
+    {
+        peak_nodes = node_count;
+    }
+    if (node_count > bucket_count - bucket_count/4)
+    {
+        Rehash(bucket_count*2);
+    }
+    return i;
+}
+
+static void HashInit(uint32_t capacity)
+{
+    node_capacity = capacity;
+    nodes = (HashNode*)malloc(sizeof(HashNode)*node_capacity);
+
+    // level 0: node 0 is a dead cell, node 1 a live one
+    memset(nodes, 0, sizeof(HashNode)*2);
+    nodes[1].population = 1;
+    node_count = 2;
+
+    Rehash(1u << 16);
+}
+
+static void HashFree()
+{
+    free(nodes);
+    free(buckets);
+    free(memo);
+    nodes = NULL;
+    buckets = NULL;
+    memo = NULL;
+}
+
+// the same rule table as the other engines
+static inline uint32_t NextCell(int alive, int neighbor_sum)
+{
+    return RULE_TABLE[alive][neighbor_sum];
+}
+
+// a level 2 node (4x4 cells) advanced one generation: its 2x2 centre
+static uint32_t Step4x4(uint32_t m)
+{
+    int cells[4][4];
+    uint32_t quads[4] = {nodes[m].nw, nodes[m].ne, nodes[m].sw, nodes[m].se};
+    for (int q = 0; q < 4; q++)
+    {
+        HashNode* n = &nodes[quads[q]];
+        int r = (q/2)*2, c = (q%2)*2;
+        cells[r][c] = n->nw;
+        cells[r][c+1] = n->ne;
+        cells[r+1][c] = n->sw;
+        cells[r+1][c+1] = n->se;
+    }
+
+    uint32_t out[4];
+    for (int k = 0; k < 4; k++)
+    {
+        int x = 1 + k/2, y = 1 + k%2;
+        int neighbor_sum = 0;
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                neighbor_sum += (dx || dy) ? cells[x+dx][y+dy] : 0;
+            }
+        }
+        out[k] = NextCell(cells[x][y], neighbor_sum);
+    }
+    return Join(out[0], out[1], out[2], out[3]);
+}
+
+/*
+* Centre of node m (level n >= 2) advanced 2^j generations, j <= n-2.
+* The nine overlapping level n-1 sub-squares are advanced first; for a full
+* 2^(n-2) jump their centres are advanced again, otherwise they are simply
+* reassembled.
+*/
+static uint32_t Successor(uint32_t m, uint32_t j)
+{
+    // Join may move the node table, so work from a copy of the node
+    HashNode n = nodes[m];
+    if (j > n.level - 2)
+    {
+        j = n.level - 2;
+    }
+    // empty space stays empty unless the rule has births on 0 neighbors
+    if (n.population == 0 && !RULE_TABLE[0][0])
+    {
+        return n.nw;
+    }
+
+    // bounded direct-mapped memo: a collision just evicts the older entry
+    uint32_t slot = (uint32_t)(HashChildren(m, j, 0, 0) & (memo_count - 1));
+    if (memo[slot].node == m && memo[slot].j == j)
+    {
+        memo_hits++;
+        return memo[slot].result;
+    }
+    memo_misses++;
+
+    uint32_t result;
+    if (n.level == 2)
+    {
+        result = Step4x4(m);
+    }
+    else
+    {
+        HashNode a = nodes[n.nw], b = nodes[n.ne], c = nodes[n.sw], d = nodes[n.se];
+
+        uint32_t c1 = Successor(n.nw, j);
+        uint32_t c2 = Successor(Join(a.ne, b.nw, a.se, b.sw), j);
+        uint32_t c3 = Successor(n.ne, j);
+        uint32_t c4 = Successor(Join(a.sw, a.se, c.nw, c.ne), j);
+        uint32_t c5 = Successor(Join(a.se, b.sw, c.ne, d.nw), j);
+        uint32_t c6 = Successor(Join(b.sw, b.se, d.nw, d.ne), j);
+        uint32_t c7 = Successor(n.sw, j);
+        uint32_t c8 = Successor(Join(c.ne, d.nw, c.se, d.sw), j);
+        uint32_t c9 = Successor(n.se, j);
+
+        if (j < n.level - 2)
+        {
+            // a short jump: the nine results already sit 2^j generations ahead
+            uint32_t q1 = Join(nodes[c1].se, nodes[c2].sw, nodes[c4].ne, nodes[c5].nw);
+            uint32_t q2 = Join(nodes[c2].se, nodes[c3].sw, nodes[c5].ne, nodes[c6].nw);
+            uint32_t q3 = Join(nodes[c4].se, nodes[c5].sw, nodes[c7].ne, nodes[c8].nw);
+            uint32_t q4 = Join(nodes[c5].se, nodes[c6].sw, nodes[c8].ne, nodes[c9].nw);
+            result = Join(q1, q2, q3, q4);
+        }
+        else
+        {
+            uint32_t q1 = Successor(Join(c1, c2, c4, c5), j);
+            uint32_t q2 = Successor(Join(c2, c3, c5, c6), j);
+            uint32_t q3 = Successor(Join(c4, c5, c7, c8), j);
+            uint32_t q4 = Successor(Join(c5, c6, c8, c9), j);
+            result = Join(q1, q2, q3, q4);
+        }
+    }
+
+    memo[slot].node = m;
+    memo[slot].j = j;
+    memo[slot].result = result;
+    return result;
+}
+
+// quadtree for the size x size square of board (row-major, side WIDTH) at (r0, c0)
+static uint32_t Build(const uint8_t* board, int r0, int c0, int size)
+{
+    if (size == 1)
+    {
+        return board[(size_t)r0*WIDTH + c0];
+    }
+    int h = size/2;
+    return Join(Build(board, r0, c0, h), Build(board, r0, c0 + h, h),
+                Build(board, r0 + h, c0, h), Build(board, r0 + h, c0 + h, h));
+}
+
+// write node m into board with its top-left cell at (r0, c0) on the torus
+static void Expand(uint32_t m, uint8_t* board, int r0, int c0)
+{
+    HashNode* n = &nodes[m];
+    if (n->level == 0)
+    {
+        board[(size_t)(r0 % HEIGHT)*WIDTH + (c0 % WIDTH)] = (uint8_t)m;
+        return;
+    }
+    if (n->population == 0)
+    {
+        return;
+    }
+    int h = 1 << (n->level - 1);
+    Expand(n->nw, board, r0, c0);
+    Expand(n->ne, board, r0, c0 + h);
+    Expand(n->sw, board, r0 + h, c0);
+    Expand(n->se, board, r0 + h, c0 + h);
+}
+
+static uint32_t Copy(uint32_t m, uint32_t* remap, HashNode* old_nodes)
+{
+    if (m < 2)
+    {
+        return m;
+    }
+    if (remap[m] != NO_NODE)
+    {
+        return remap[m];
+    }
+    HashNode* n = &old_nodes[m];
+    uint32_t nw = Copy(n->nw, remap, old_nodes);
+    uint32_t ne = Copy(n->ne, remap, old_nodes);
+    uint32_t sw = Copy(n->sw, remap, old_nodes);
+    uint32_t se = Copy(n->se, remap, old_nodes);
+    remap[m] = Join(nw, ne, sw, se);
+    return remap[m];
+}
+
+/*
+* Evict everything not reachable from root: copy the live tree into a fresh
+* node table and drop the memo, whose entries may point at evicted nodes.
+*/
+static uint32_t Collect(uint32_t root)
+{
+    HashNode* old_nodes = nodes;
+    uint32_t old_count = node_count;
+
+    uint32_t* remap = (uint32_t*)malloc(sizeof(uint32_t)*old_count);
+    memset(remap, 0xff, sizeof(uint32_t)*old_count);
+
+    nodes = (HashNode*)malloc(sizeof(HashNode)*node_capacity);
+    memcpy(nodes, old_nodes, sizeof(HashNode)*2);
+    node_count = 2;
+    Rehash(bucket_count);
+
+    root = Copy(root, remap, old_nodes);
+
+    free(remap);
+    free(old_nodes);
+    memset(memo, 0xff, sizeof(HashMemo)*memo_count);
+    collections++;
+    return root;
+}
+
+void SimulateHashLife(int rank, int p, int num_iterations, const GolOptions* opts)
+{
+    int n = 0;
+    while ((1 << n) < HEIGHT)
+    {
+        n++;
+    }
+    if ((1 << n) != HEIGHT || HEIGHT != WIDTH || n < 2)
+    {
+        if (rank == 0)
+        {
+            printf("hashlife needs a power of two board_size of at least 4\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    /*
+    * Every proc generates its strip of the initial board, then p0
+    * assembles the board; the quadtree itself lives on p0 only.
+    */
+    int rows = BlockSize(HEIGHT, p, rank);
+    int row0 = BlockStart(HEIGHT, p, rank);
+    uint8_t* strip = (uint8_t*)malloc((size_t)rows*WIDTH);
+    for (int i = 0; i < rows; i++)
+    {
+        InitialRow(row0 + i, 0, WIDTH, &strip[(size_t)i*WIDTH]);
+    }
+
+    int* counts = (int*)malloc(sizeof(int)*p);
+    int* displs = (int*)malloc(sizeof(int)*p);
+    for (int i = 0; i < p; i++)
+    {
+        counts[i] = BlockSize(HEIGHT, p, i)*WIDTH;
+        displs[i] = BlockStart(HEIGHT, p, i)*WIDTH;
+    }
+
+    uint8_t* board = NULL;
+    if (rank == 0)
+    {
+        board = (uint8_t*)malloc((size_t)HEIGHT*WIDTH);
+    }
+
+    double comm_start = MPI_Wtime();
+    MPI_Gatherv(strip, rows*WIDTH, MPI_UNSIGNED_CHAR, board, counts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    total_comm_time += MPI_Wtime() - comm_start;
+
+    free(strip);
+    free(counts);
+    free(displs);
+
+    if (rank == 0)
+    {
+        uint32_t node_limit = opts->hashlife_nodes;
+        HashInit(node_limit);
+
+        memo_count = 1u << 20;
+        memo = (HashMemo*)malloc(sizeof(HashMemo)*memo_count);
+        memset(memo, 0xff, sizeof(HashMemo)*memo_count);
+
+        uint32_t root = Build(board, 0, 0, HEIGHT);
+        int offset = 0;
+
+        // jump by the largest power of two left, capped at 2^(n-1) per tile
+        long long remaining = num_iterations;
+        while (remaining > 0)
+        {
+            uint32_t j = 0;
+            while (j + 1 <= (uint32_t)(n - 1) && (1LL << (j + 1)) <= remaining)
+            {
+                j++;
+            }
+
+            uint32_t tile = Join(root, root, root, root);
+            root = Successor(tile, j);
+            offset = (offset + HEIGHT/2) % HEIGHT;
+            remaining -= 1LL << j;
+
+            // keep the node table bounded between jumps
+            if (node_count > node_limit)
+            {
+                root = Collect(root);
+            }
+
+            if (__DEBUG__)
+            {
+                printf("hashlife jumped 2^%u generations, %u nodes\n", j, node_count);
+            }
+        }
+
+        // node (a, b) sits at board cell (a + offset, b + offset)
+        memset(board, 0, (size_t)HEIGHT*WIDTH);
+        Expand(root, board, offset, offset);
+
+        hashlife_population = (double)nodes[root].population;
+        hashlife_peak_nodes = (double)peak_nodes;
+        hashlife_bytes = (double)sizeof(HashNode)*node_capacity + sizeof(uint32_t)*(double)bucket_count
+                       + sizeof(HashMemo)*(double)memo_count;
+        hashlife_hit_rate = (memo_hits + memo_misses) > 0 ? memo_hits/(memo_hits + memo_misses) : 0.0;
+        hashlife_collections = collections;
+        board_bytes_per_proc = hashlife_bytes;
+
+        if (opts->print_board)
+        {
+            for (int i = 0; i < HEIGHT; i++)
+            {
+                for (int k = 0; k < WIDTH; k++)
+                {
+                    printf("%d ", board[(size_t)i*WIDTH + k]);
+                }
+                printf("\n");
+            }
+            printf("\n");
+        }
+
+        HashFree();
+        free(board);
+    }
+}
@@ -0,0 +1,253 @@
+/*
+* Ethan Vincent
+* Parallel board snapshots with MPI-IO, used for final dumps, periodic
+* checkpoints and restarts
+*
+* File layout: a 128 byte GolSnapshotHeader, then HEIGHT rows of row_bytes
+* each. A row is cut into the writer's column blocks (segments), each
+* packed on its own from a byte boundary: cell j of a segment in bit j%8
+* of its byte j/8. Every proc then owns whole bytes of the file and writes
+* its block straight through a file view, with no gather to a leader.
+* Header fields are written in the native (little-endian on our nodes)
+* byte order.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+#define SNAPSHOT_MAGIC "GOLSNAP2"
+#define SNAPSHOT_VERSION 2
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    uint64_t height;
+    uint64_t width;
+    uint64_t generation;
+    uint64_t row_bytes;
+    uint32_t segments;      // column blocks of each row
+    uint32_t reserved32;
+    char rule[64];          // canonical RULE.name the board was run under
+    uint8_t reserved[8];
+} GolSnapshotHeader;
+
+// byte offset of each segment within a row, and the row length at offsets[segments]
+static size_t* SegmentOffsets(int segments)
+{
+    size_t* offsets = (size_t*)malloc(sizeof(size_t)*(segments + 1));
+    offsets[0] = 0;
+    for (int s = 0; s < segments; s++)
+    {
+        offsets[s+1] = offsets[s] + (BlockSize(WIDTH, segments, s) + 7)/8;
+    }
+    return offsets;
+}
+
+/*
+* Set a file view of the rows from row0 on x bytes [byte0, byte0 + bytes)
+* of the packed board and return the type of one row's piece. The view
+* tiles one piece every row_bytes, so counts are in whole pieces and stay
+* below the board height however wide the rows are.
+*/
+static MPI_Datatype SetBlockView(MPI_File fh, MPI_Offset header_bytes, size_t row_bytes,
+                                 int row0, size_t byte0, size_t bytes)
+{
+    MPI_Datatype piece;
+    MPI_Type_contiguous((int)bytes, MPI_BYTE, &piece);
+    MPI_Type_commit(&piece);
+
+    MPI_Datatype row_view;
+    MPI_Type_create_resized(piece, 0, (MPI_Aint)row_bytes, &row_view);
+    MPI_Type_commit(&row_view);
+
+    MPI_Offset disp = header_bytes + (MPI_Offset)row0*row_bytes + (MPI_Offset)byte0;
+    MPI_File_set_view(fh, disp, MPI_BYTE, row_view, "native", MPI_INFO_NULL);
+    MPI_Type_free(&row_view);
+    return piece;
+}
+
+/*
+* Collectively write the current board to path. The file is first written
+* as path.tmp and renamed once complete, so a job killed mid-write leaves
+* the previous snapshot intact.
+*/
+void WriteSnapshot(const char* path, GolGrid* grid, GolHalo* halo, long long generation)
+{
+    double start = MPI_Wtime();
+    int rank;
+    MPI_Comm_rank(halo->cart, &rank);
+
+    int segments = halo->dims[1];
+    size_t* offsets = SegmentOffsets(segments);
+    size_t row_bytes = offsets[segments];
+    size_t byte0 = offsets[halo->coords[1]];
+    size_t bytes = offsets[halo->coords[1] + 1] - byte0;
+    free(offsets);
+
+    // this proc's segment of each of its rows, packed to bits
+    uint8_t* packed = (uint8_t*)calloc((size_t)grid->rows*bytes, 1);
+    for (int i = 0; i < grid->rows; i++)
+    {
+        uint8_t* row = GridRow(grid, grid->cur, i);
+        for (int j = 0; j < grid->cols; j++)
+        {
+            packed[(size_t)i*bytes + j/8] |= row[j] << (j % 8);
+        }
+    }
+
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    MPI_File fh;
+    if (MPI_File_open(halo->cart, tmp_path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+    {
+        if (rank == 0)
+        {
+            printf("could not open snapshot file %s\n", tmp_path);
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+    MPI_File_set_size(fh, 0);
+
+    if (rank == 0)
+    {
+        GolSnapshotHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, 8);
+        header.version = SNAPSHOT_VERSION;
+        header.header_bytes = sizeof(header);
+        header.height = HEIGHT;
+        header.width = WIDTH;
+        header.generation = generation;
+        header.row_bytes = row_bytes;
+        header.segments = segments;
+        snprintf(header.rule, sizeof(header.rule), "%s", RULE.name);
+        MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+
+    MPI_Datatype piece = SetBlockView(fh, sizeof(GolSnapshotHeader), row_bytes, grid->row0, byte0, bytes);
+    MPI_File_write_all(fh, packed, grid->rows, piece, MPI_STATUS_IGNORE);
+    MPI_File_close(&fh);
+    MPI_Type_free(&piece);
+
+    // a failed rename leaves the previous snapshot as the latest one, so do not carry on as if saved
+    if (rank == 0 && rename(tmp_path, path) != 0)
+    {
+        printf("could not rename snapshot file %s to %s\n", tmp_path, path);
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+    MPI_Barrier(halo->cart);
+
+    free(packed);
+
+    snapshot_bytes += (double)grid->rows*bytes;
+    snapshot_time += MPI_Wtime() - start;
+    snapshot_count++;
+}
+
+/*
+* Collectively load a snapshot into the current board; returns its
+* generation. The file's segments need not match this run's column
+* blocks: each proc reads the run of bytes that covers its columns and
+* unpacks them segment by segment.
+*/
+long long ReadSnapshot(const char* path, GolGrid* grid, GolHalo* halo)
+{
+    int rank;
+    MPI_Comm_rank(halo->cart, &rank);
+
+    MPI_File fh;
+    if (MPI_File_open(halo->cart, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+    {
+        if (rank == 0)
+        {
+            printf("could not open snapshot file %s\n", path);
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    GolSnapshotHeader header;
+    MPI_File_read_at_all(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, 8) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.height != (uint64_t)HEIGHT || header.width != (uint64_t)WIDTH ||
+        header.segments == 0 || header.segments > (uint32_t)WIDTH)
+    {
+        if (rank == 0)
+        {
+            printf("%s is not a %dx%d snapshot\n", path, HEIGHT, WIDTH);
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    // continuing a board under other dynamics would silently give a different run
+    header.rule[sizeof(header.rule)-1] = '\0';
+    if (strcmp(header.rule, RULE.name) != 0)
+    {
+        if (rank == 0)
+        {
+            printf("%s was written under rule %s, not %s\n", path, header.rule, RULE.name);
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    int segments = (int)header.segments;
+    size_t* offsets = SegmentOffsets(segments);
+    if (offsets[segments] != header.row_bytes)
+    {
+        if (rank == 0)
+        {
+            printf("%s has %llu bytes per row, expected %zu\n", path, (unsigned long long)header.row_bytes, offsets[segments]);
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    // the file segments holding this proc's first and last columns, and every byte between
+    int first = 0;
+    while (BlockStart(WIDTH, segments, first) + BlockSize(WIDTH, segments, first) <= grid->col0)
+    {
+        first++;
+    }
+    int last = first;
+    while (BlockStart(WIDTH, segments, last) + BlockSize(WIDTH, segments, last) < grid->col0 + grid->cols)
+    {
+        last++;
+    }
+    size_t byte0 = offsets[first];
+    size_t bytes = offsets[last + 1] - byte0;
+
+    uint8_t* packed = (uint8_t*)malloc((size_t)grid->rows*bytes);
+    MPI_Datatype piece = SetBlockView(fh, header.header_bytes, header.row_bytes, grid->row0, byte0, bytes);
+    MPI_File_read_all(fh, packed, grid->rows, piece, MPI_STATUS_IGNORE);
+    MPI_File_close(&fh);
+    MPI_Type_free(&piece);
+
+    for (int i = 0; i < grid->rows; i++)
+    {
+        uint8_t* row = GridRow(grid, grid->cur, i);
+        const uint8_t* in = &packed[(size_t)i*bytes];
+        int s = first;
+        int s_end = BlockStart(WIDTH, segments, s) + BlockSize(WIDTH, segments, s);
+        for (int j = 0; j < grid->cols; j++)
+        {
+            int col = grid->col0 + j;
+            if (col >= s_end)
+            {
+                s++;
+                s_end = BlockStart(WIDTH, segments, s) + BlockSize(WIDTH, segments, s);
+            }
+            int bit = col - BlockStart(WIDTH, segments, s);
+            row[j] = (in[offsets[s] - byte0 + bit/8] >> (bit % 8)) & 1;
+        }
+    }
+
+    free(packed);
+    free(offsets);
+    return (long long)header.generation;
+}
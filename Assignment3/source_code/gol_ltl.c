@@ -0,0 +1,110 @@
+/*
+* Ethan Vincent
+* Larger than Life: life-like rules over the (2r+1) x (2r+1) box around a
+* cell for any radius r. Box counts come from two sliding windows, one
+* down each column and one along the row, so a cell costs a handful of
+* adds whatever r is instead of (2r+1)^2
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gol.h"
+
+// rows a worker slides down before rebuilding its column sums from scratch
+#define LTL_CHUNK_MIN 64
+
+// one row of column sums per worker thread, allocated once per run
+static uint16_t* column_sums = NULL;
+static int column_width = 0;
+
+static inline uint8_t InRange(int count, int min, int max)
+{
+    return count >= min && count <= max;
+}
+
+// width is the widest region plus 2r, at most the grid's padded row
+void LtlCreate(int width, int threads)
+{
+    column_width = width;
+    column_sums = (uint16_t*)malloc(sizeof(uint16_t)*(size_t)width*threads);
+}
+
+void LtlFree(void)
+{
+    free(column_sums);
+    column_sums = NULL;
+}
+
+/*
+* Compute cells [r0, r1) x [c0, c1) of the next generation. column[k]
+* holds the count of rows x-r..x+r in column c0-r+k; moving to the next
+* row adds the row entering the box and drops the one leaving it. Along
+* the row, the box count adds the column entering on the right and drops
+* the one leaving on the left. Rows are cut into chunks so the worker
+* threads each slide down their own, and a chunk is at least 4r rows so
+* building its first column sums stays a small share of the work.
+*/
+void LtlStepRegion(GolGrid* grid, int r0, int r1, int c0, int c1)
+{
+    int r = RULE.radius;
+    int width = c1 - c0 + 2*r;
+    int chunk = 4*r > LTL_CHUNK_MIN ? 4*r : LTL_CHUNK_MIN;
+    int chunks = (r1 - r0 + chunk - 1)/chunk;
+
+    #pragma omp parallel for schedule(static) if (chunks > 1)
+    for (int k = 0; k < chunks; k++)
+    {
+        int xa = r0 + k*chunk;
+        int xb = xa + chunk < r1 ? xa + chunk : r1;
+#ifdef _OPENMP
+        uint16_t* column = column_sums + (size_t)omp_get_thread_num()*column_width;
+#else
+        uint16_t* column = column_sums;
+#endif
+        memset(column, 0, sizeof(uint16_t)*width);
+
+        for (int dx = -r; dx <= r; dx++)
+        {
+            const uint8_t* row = GridRow(grid, grid->cur, xa + dx) + c0 - r;
+            for (int j = 0; j < width; j++)
+            {
+                column[j] += row[j];
+            }
+        }
+
+        for (int x = xa; x < xb; x++)
+        {
+            if (x > xa)
+            {
+                const uint8_t* enter = GridRow(grid, grid->cur, x + r) + c0 - r;
+                const uint8_t* leave = GridRow(grid, grid->cur, x - r - 1) + c0 - r;
+                for (int j = 0; j < width; j++)
+                {
+                    column[j] += enter[j] - leave[j];
+                }
+            }
+
+            const uint8_t* mid = GridRow(grid, grid->cur, x) + c0;
+            uint8_t* out = GridRow(grid, grid->next, x) + c0;
+            int count = 0;
+            for (int j = 0; j < 2*r; j++)
+            {
+                count += column[j];
+            }
+            for (int j = 0; j < c1 - c0; j++)
+            {
+                count += column[j + 2*r];
+                int box = RULE.middle ? count : count - mid[j];
+                out[j] = mid[j] ? InRange(box, RULE.survive_min, RULE.survive_max)
+                                : InRange(box, RULE.birth_min, RULE.birth_max);
+                count -= column[j];
+            }
+        }
+    }
+}
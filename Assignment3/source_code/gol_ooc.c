@@ -0,0 +1,309 @@
+/*
+* Ethan Vincent
+* Out-of-core engine: each proc's strip of both boards lives in a memory-
+* mapped file instead of RAM, and every generation sweeps it in bands of
+* rows. Only a two-band window of each board stays mapped in: the band
+* after the one being computed is read ahead while it is computed, and
+* bands behind the window are handed back to the page cache, so a board
+* larger than the memory of all procs runs at disk or page cache speed.
+*/
+
+// sync_file_range
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+/*
+* One board of the strip in its own file. Row i keeps cell j at
+* cells[i*stride + 1 + j], with wrapped copies of cells WIDTH-1 and 0 on
+* either side, so the row kernels run on it unchanged.
+*/
+typedef struct
+{
+    int fd;
+    uint8_t* cells;
+    size_t bytes;
+} OocBoard;
+
+static int STRIDE = 0;
+static size_t PAGE = 4096;
+
+static inline uint8_t* OocRow(const OocBoard* board, int i)
+{
+    return board->cells + (size_t)i*STRIDE + 1;
+}
+
+// create, size and map a board file; -1 if the directory cannot hold it
+static int OocOpen(OocBoard* board, const char* dir, int rank, int which, size_t bytes)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/gol_ooc_%d_%d.bin", dir, rank, which);
+
+    board->bytes = bytes;
+    board->cells = MAP_FAILED;
+    board->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (board->fd < 0)
+    {
+        return -1;
+    }
+
+    // the file lives on only through the mapping, so nothing is left behind if the run dies
+    unlink(path);
+
+    // reserve the blocks now: running out of disk mid-run would be a SIGBUS on a store
+    if (posix_fallocate(board->fd, 0, bytes) != 0)
+    {
+        return -1;
+    }
+    board->cells = (uint8_t*)mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, board->fd, 0);
+    return board->cells == MAP_FAILED ? -1 : 0;
+}
+
+static void OocClose(OocBoard* board)
+{
+    if (board->cells != MAP_FAILED)
+    {
+        munmap(board->cells, board->bytes);
+    }
+    if (board->fd >= 0)
+    {
+        close(board->fd);
+    }
+}
+
+// madvise rows [r0, r1), widened to whole pages
+static void OocAdvise(OocBoard* board, int r0, int r1, int advice)
+{
+    size_t start = (size_t)r0*STRIDE / PAGE*PAGE;
+    size_t end = (size_t)r1*STRIDE;
+    end = end < board->bytes ? end : board->bytes;
+    if (end > start)
+    {
+        madvise(board->cells + start, end - start, advice);
+    }
+}
+
+/*
+* Hand rows [r0, r1) back: start writing them out if they were written,
+* then unmap them from this proc. The pages stay in the page cache for as
+* long as the kernel has room, so a board that fits there never touches
+* the disk, and one that does not is written back a band at a time
+* instead of all at once when memory runs out.
+*/
+static void OocRelease(OocBoard* board, int r0, int r1, int dirty)
+{
+    // whole pages only, so a page shared with a row still in the window stays mapped
+    size_t start = ((size_t)r0*STRIDE + PAGE - 1) / PAGE*PAGE;
+    size_t end = (size_t)r1*STRIDE / PAGE*PAGE;
+    if (end <= start)
+    {
+        return;
+    }
+    if (dirty)
+    {
+        sync_file_range(board->fd, start, end - start, SYNC_FILE_RANGE_WRITE);
+    }
+    madvise(board->cells + start, end - start, MADV_DONTNEED);
+}
+
+// fill the strip's rows a band at a time, so generating never needs the whole strip either
+static void GenerateInitialOoc(OocBoard* board, int row0, int rows, int band)
+{
+    for (int x0 = 0; x0 < rows; x0 += band)
+    {
+        int x1 = x0 + band < rows ? x0 + band : rows;
+        for (int x = x0; x < x1; x++)
+        {
+            uint8_t* row = OocRow(board, x);
+            InitialRow(row0 + x, 0, WIDTH, row);
+            row[-1] = row[WIDTH-1];
+            row[WIDTH] = row[0];
+        }
+        OocRelease(board, x0, x1, 1);
+    }
+}
+
+static void PrintBoardOoc(OocBoard* board, int rows, int rank, int p)
+{
+    // the owned cells of every row, straight out of the mapping
+    MPI_Datatype strip;
+    MPI_Type_vector(rows, WIDTH, STRIDE, MPI_UNSIGNED_CHAR, &strip);
+    MPI_Type_commit(&strip);
+
+    if (rank != 0)
+    {
+        MPI_Send(OocRow(board, 0), 1, strip, 0, 0, MPI_COMM_WORLD);
+        MPI_Type_free(&strip);
+        return;
+    }
+
+    uint8_t* recv_board = (uint8_t*)malloc((size_t)BlockSize(HEIGHT, p, 0)*WIDTH);
+    for (int i = 0; i < p; i++)
+    {
+        int n = BlockSize(HEIGHT, p, i);
+        if (i == 0)
+        {
+            MPI_Sendrecv(OocRow(board, 0), 1, strip, 0, 0, recv_board, n*WIDTH, MPI_UNSIGNED_CHAR, 0, 0,
+                         MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+        else
+        {
+            MPI_Recv(recv_board, n*WIDTH, MPI_UNSIGNED_CHAR, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+        for (int j = 0; j < n; j++)
+        {
+            for (int k = 0; k < WIDTH; k++)
+            {
+                printf("%d ", recv_board[(size_t)j*WIDTH + k]);
+            }
+            printf("\n");
+        }
+    }
+    printf("\n");
+    free(recv_board);
+    MPI_Type_free(&strip);
+}
+
+void SimulateOutOfCore(int rank, int p, int num_iterations, const GolOptions* opts)
+{
+    int rows = BlockSize(HEIGHT, p, rank);
+    int row0 = BlockStart(HEIGHT, p, rank);
+    int band = opts->ooc_band;
+    STRIDE = GridStride(WIDTH, 1);
+    PAGE = (size_t)sysconf(_SC_PAGESIZE);
+
+    // every proc needs a row of its own to send
+    if (HEIGHT < p)
+    {
+        if (rank == 0)
+        {
+            printf("board_size %d is too small for %d procs\n", HEIGHT, p);
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    OocBoard boards[2];
+    size_t bytes = (size_t)rows*STRIDE;
+    int failed = OocOpen(&boards[0], opts->ooc_dir, rank, 0, bytes) != 0;
+    failed |= OocOpen(&boards[1], opts->ooc_dir, rank, 1, bytes) != 0;
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+    if (failed)
+    {
+        if (rank == 0)
+        {
+            printf("cannot map %.0lf bytes of board files per proc in %s\n", 2.0*bytes, opts->ooc_dir);
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+    OocBoard* cur = &boards[0];
+    OocBoard* next = &boards[1];
+
+    // the neighboring strips' edge rows, wrapped columns included
+    uint8_t* ghost_above = (uint8_t*)malloc(STRIDE);
+    uint8_t* ghost_below = (uint8_t*)malloc(STRIDE);
+
+    GolRowKernel step_row = SelectRowKernel(opts->kernel, &kernel_name);
+
+    // resident: the window of both boards and the ghost rows; the rest stays in the files
+    int window = 2*band < rows ? 2*band : rows;
+    board_bytes_per_proc = 2.0*window*STRIDE + 2.0*STRIDE;
+    halo_bytes_per_generation = 2.0*STRIDE;
+    ooc_file_bytes = 2.0*bytes;
+    page_mode_used = "file";
+
+    GenerateInitialOoc(cur, row0, rows, band);
+
+    int up = (rank + p - 1) % p;
+    int down = (rank + 1) % p;
+
+    for (int i = 0; i < num_iterations; i++)
+    {
+        TimingBeginGeneration();
+        if (GENERATION_BARRIER)
+        {
+            double barrier_start = MPI_Wtime();
+            MPI_Barrier(MPI_COMM_WORLD);
+            TimingAdd(TIMER_BARRIER, MPI_Wtime() - barrier_start);
+        }
+
+        // the first band's reads start while the edge rows are exchanged
+        OocAdvise(cur, 0, band + 1, MADV_WILLNEED);
+        OocAdvise(next, 0, band, MADV_WILLNEED);
+
+        double comm_start = MPI_Wtime();
+        if (p != 1)
+        {
+            MPI_Sendrecv(OocRow(cur, 0) - 1, STRIDE, MPI_UNSIGNED_CHAR, up, 1,
+                         ghost_below, STRIDE, MPI_UNSIGNED_CHAR, down, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            MPI_Sendrecv(OocRow(cur, rows-1) - 1, STRIDE, MPI_UNSIGNED_CHAR, down, 2,
+                         ghost_above, STRIDE, MPI_UNSIGNED_CHAR, up, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+        else
+        {
+            memcpy(ghost_below, OocRow(cur, 0) - 1, STRIDE);
+            memcpy(ghost_above, OocRow(cur, rows-1) - 1, STRIDE);
+        }
+        double comm_end = MPI_Wtime();
+        total_comm_time += comm_end - comm_start;
+        TimingAdd(TIMER_WAIT, comm_end - comm_start);
+
+        for (int x0 = 0; x0 < rows; x0 += band)
+        {
+            int x1 = x0 + band < rows ? x0 + band : rows;
+
+            // read ahead the next band of both boards while this one is computed;
+            // the old contents of next are read in before a store can overwrite them
+            if (x1 < rows)
+            {
+                OocAdvise(cur, x1 + 1, x1 + band + 1, MADV_WILLNEED);
+                OocAdvise(next, x1, x1 + band, MADV_WILLNEED);
+            }
+
+            #pragma omp parallel for schedule(static) if (x1 - x0 > 8)
+            for (int x = x0; x < x1; x++)
+            {
+                const uint8_t* above = x == 0 ? ghost_above + 1 : OocRow(cur, x-1);
+                const uint8_t* below = x == rows-1 ? ghost_below + 1 : OocRow(cur, x+1);
+                uint8_t* out = OocRow(next, x);
+                step_row(above, OocRow(cur, x), below, out, WIDTH);
+                out[-1] = out[WIDTH-1];
+                out[WIDTH] = out[0];
+            }
+
+            // rows before x0 - 1 are never read again this generation
+            OocRelease(cur, x0 - band - 1 > 0 ? x0 - band - 1 : 0, x0 - 1, 0);
+            OocRelease(next, x0, x1, 1);
+        }
+        OocRelease(cur, 0, rows, 0);
+
+        OocBoard* tmp = cur;
+        cur = next;
+        next = tmp;
+        TimingAdd(TIMER_COMPUTE, MPI_Wtime() - comm_end);
+        TimingEndGeneration();
+
+        if (__DEBUG__)
+        {
+            printf("Process %d has finished out-of-core iteration %d\n", rank, i);
+        }
+    }
+
+    if (opts->print_board)
+    {
+        PrintBoardOoc(cur, rows, rank, p);
+    }
+
+    free(ghost_above);
+    free(ghost_below);
+    OocClose(&boards[0]);
+    OocClose(&boards[1]);
+}
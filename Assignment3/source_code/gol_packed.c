@@ -0,0 +1,334 @@
+/*
+* Ethan Vincent
+* Bit-packed Game of Life engine: 64 cells per uint64_t, with neighbor
+* counts computed 64 cells at a time by a bit-parallel adder tree
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+// number of 64-bit words in a packed row
+static int WORDS = 0;
+
+// all ones where RULE_TABLE[0][c] (births) or RULE_TABLE[1][c] (survivals) is set
+static uint64_t birth_words[9];
+static uint64_t survive_words[9];
+static int default_rule = 1;
+
+static inline uint64_t GetCell(const uint64_t* row, int j)
+{
+    return (row[j >> 6] >> (j & 63)) & 1;
+}
+
+// bit j of out holds cell j-1 (wrapping cell 0 back to WIDTH-1)
+static void ShiftWest(const uint64_t* row, uint64_t* out)
+{
+    uint64_t carry = GetCell(row, WIDTH-1);
+    for (int w = 0; w < WORDS; w++)
+    {
+        out[w] = (row[w] << 1) | carry;
+        carry = row[w] >> 63;
+    }
+}
+
+// bit j of out holds cell j+1 (wrapping cell WIDTH-1 back to 0)
+static void ShiftEast(const uint64_t* row, uint64_t* out)
+{
+    for (int w = 0; w < WORDS-1; w++)
+    {
+        out[w] = (row[w] >> 1) | (row[w+1] << 63);
+    }
+    out[WORDS-1] = (row[WORDS-1] >> 1) | (GetCell(row, 0) << ((WIDTH-1) & 63));
+}
+
+void GenerateInitialPacked(uint64_t* board, int rank, int p)
+{
+    // a packed word is exactly one InitialWord, so the strip fills a word at a time
+    int row0 = BlockStart(HEIGHT, p, rank);
+    for (int i = 0; i < BlockSize(HEIGHT, p, rank); i++)
+    {
+        uint64_t* row = &board[(size_t)(i+1)*WORDS];
+        for (int w = 0; w < WORDS; w++)
+        {
+            row[w] = InitialWord(row0 + i, w);
+        }
+        if (WIDTH & 63)
+        {
+            row[WORDS-1] &= (1ULL << (WIDTH & 63)) - 1;
+        }
+    }
+}
+
+void PrintBoardPacked(uint64_t* board, int rank, int p)
+{
+    int rows = BlockSize(HEIGHT, p, rank);
+
+    // every proc ships its packed strip to p0
+    if (rank != 0)
+    {
+        MPI_Send(&board[WORDS], rows*WORDS, MPI_UINT64_T, 0, 0, MPI_COMM_WORLD);
+        return;
+    }
+
+    // p0 holds the largest strip, since the extra rows go to the lowest ranks
+    uint64_t* recv_board = (uint64_t*)malloc(sizeof(uint64_t)*rows*WORDS);
+    for (int i = 0; i < p; i++)
+    {
+        uint64_t* strip = &board[WORDS];
+        int n = BlockSize(HEIGHT, p, i);
+        if (i != 0)
+        {
+            MPI_Recv(recv_board, n*WORDS, MPI_UINT64_T, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            strip = recv_board;
+        }
+
+        // unpack on p0 only
+        for (int j = 0; j < n; j++)
+        {
+            for (int k = 0; k < WIDTH; k++)
+            {
+                printf("%d ", (int)GetCell(&strip[j*WORDS], k));
+            }
+            printf("\n");
+        }
+    }
+    printf("\n");
+    free(recv_board);
+}
+
+/*
+* Compute one packed row of the next generation. Each neighbor direction is
+* a 64-wide bit vector; the eight of them are summed bit-sliced into a 4-bit
+* count (s1, s2, s4, s8) using full and half adders. Rules other than the
+* default match the count against each of 0..8 and pick birth or survival
+* by the cell's own bit.
+*/
+static void StepRow(const uint64_t* above_w, const uint64_t* above, const uint64_t* above_e,
+                    const uint64_t* mid_w, const uint64_t* mid, const uint64_t* mid_e,
+                    const uint64_t* below_w, const uint64_t* below, const uint64_t* below_e,
+                    uint64_t* out)
+{
+    for (int w = 0; w < WORDS; w++)
+    {
+        // full adder over the row above
+        uint64_t a0 = above_w[w], a1 = above[w], a2 = above_e[w];
+        uint64_t sa = a0 ^ a1 ^ a2;
+        uint64_t ca = (a0 & a1) | (a2 & (a0 ^ a1));
+
+        // full adder over the row below
+        uint64_t b0 = below_w[w], b1 = below[w], b2 = below_e[w];
+        uint64_t sb = b0 ^ b1 ^ b2;
+        uint64_t cb = (b0 & b1) | (b2 & (b0 ^ b1));
+
+        // half adder over the left and right neighbors
+        uint64_t sm = mid_w[w] ^ mid_e[w];
+        uint64_t cm = mid_w[w] & mid_e[w];
+
+        // ones column
+        uint64_t s1 = sa ^ sb ^ sm;
+        uint64_t k1 = (sa & sb) | (sm & (sa ^ sb));
+
+        // twos column: ca + cb + cm + k1
+        uint64_t t = ca ^ cb ^ cm;
+        uint64_t u = (ca & cb) | (cm & (ca ^ cb));
+        uint64_t s2 = t ^ k1;
+        uint64_t v = t & k1;
+
+        // fours and eights columns
+        uint64_t s4 = u ^ v;
+        uint64_t s8 = u & v;
+
+        if (default_rule)
+        {
+            // alive when 2 < neighbor_sum < 6, i.e. a count of 3 (011), 4 (100) or 5 (101)
+            out[w] = ~s8 & ((~s4 & s2 & s1) | (s4 & ~s2));
+            continue;
+        }
+
+        uint64_t self = mid[w];
+        uint64_t next = 0;
+        for (int c = 0; c <= 8; c++)
+        {
+            uint64_t eq = ((c & 1) ? s1 : ~s1) & ((c & 2) ? s2 : ~s2) & ((c & 4) ? s4 : ~s4) & ((c & 8) ? s8 : ~s8);
+            next |= eq & ((birth_words[c] & ~self) | (survive_words[c] & self));
+        }
+        out[w] = next;
+    }
+
+    // keep the padding bits past WIDTH cleared
+    if (WIDTH & 63)
+    {
+        out[WORDS-1] &= (1ULL << (WIDTH & 63)) - 1;
+    }
+}
+
+// record generation's board; nonzero once it repeats a recent one (collective)
+static int PackedDetect(uint64_t* board, int rank, int p, int generation)
+{
+    uint64_t hash = 0, check = 0, population = 0;
+    int row0 = BlockStart(HEIGHT, p, rank);
+    for (int x = 1; x <= BlockSize(HEIGHT, p, rank); x++)
+    {
+        uint64_t* row = &board[(size_t)x*WORDS];
+        HashCells((const uint8_t*)row, sizeof(uint64_t)*WORDS, (uint64_t)(row0 + x - 1) << 32, &hash, &check);
+        for (int w = 0; w < WORDS; w++)
+        {
+            population += __builtin_popcountll(row[w]);
+        }
+    }
+    return DetectStep(hash, check, population, generation);
+}
+
+void SimulatePacked(int rank, int p, int num_iterations, const GolOptions* opts)
+{
+    // the first HEIGHT % p strips take one extra row, as in the grid engine's split
+    int rows = BlockSize(HEIGHT, p, rank);
+    WORDS = (WIDTH + 63)/64;
+
+    // every strip needs a row of its own to send
+    if (HEIGHT < p)
+    {
+        if (rank == 0)
+        {
+            printf("board_size %d is too small for %d procs\n", HEIGHT, p);
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    default_rule = RuleIsDefault();
+    for (int c = 0; c <= 8; c++)
+    {
+        birth_words[c] = RULE_TABLE[0][c] ? ~0ULL : 0;
+        survive_words[c] = RULE_TABLE[1][c] ? ~0ULL : 0;
+    }
+
+    // two boards with a ghost row above and below the strip
+    size_t board_words = (size_t)(rows+2)*WORDS;
+    GolBlock board_block, new_board_block;
+    uint64_t* board = (uint64_t*)GolAlloc(&board_block, board_words*sizeof(uint64_t));
+    uint64_t* new_board = (uint64_t*)GolAlloc(&new_board_block, board_words*sizeof(uint64_t));
+    memset(board, 0, board_words*sizeof(uint64_t));
+    memset(new_board, 0, board_words*sizeof(uint64_t));
+
+    // west/east shifted copies of the three rows around the one being computed
+    uint64_t* west = (uint64_t*)malloc(sizeof(uint64_t)*3*WORDS);
+    uint64_t* east = (uint64_t*)malloc(sizeof(uint64_t)*3*WORDS);
+
+    board_bytes_per_proc = 2.0*board_words*sizeof(uint64_t);
+    halo_bytes_per_generation = 2.0*WORDS*sizeof(uint64_t);
+
+    GenerateInitialPacked(board, rank, p);
+
+    int up = (rank + p - 1) % p;
+    int down = (rank + 1) % p;
+
+    // the halo rows always go between the same neighbors, into one of the
+    // two boards; set both request sets up once and restart them each generation
+    MPI_Request requests[2][4];
+    uint64_t* planes[2] = {board, new_board};
+    for (int b = 0; b < 2 && p != 1; b++)
+    {
+        MPI_Recv_init(&planes[b][0], WORDS, MPI_UINT64_T, up, 2, MPI_COMM_WORLD, &requests[b][0]);
+        MPI_Recv_init(&planes[b][(rows+1)*WORDS], WORDS, MPI_UINT64_T, down, 1, MPI_COMM_WORLD, &requests[b][1]);
+        MPI_Send_init(&planes[b][WORDS], WORDS, MPI_UINT64_T, up, 1, MPI_COMM_WORLD, &requests[b][2]);
+        MPI_Send_init(&planes[b][rows*WORDS], WORDS, MPI_UINT64_T, down, 2, MPI_COMM_WORLD, &requests[b][3]);
+    }
+
+    if (opts->detect_period > 0)
+    {
+        DetectCreate(opts->detect_period, 0, num_iterations);
+        PackedDetect(board, rank, p, 0);
+    }
+
+    for (int i = 0; i < num_iterations; i++)
+    {
+        TimingBeginGeneration();
+        if (GENERATION_BARRIER)
+        {
+            double barrier_start = MPI_Wtime();
+            MPI_Barrier(MPI_COMM_WORLD);
+            TimingAdd(TIMER_BARRIER, MPI_Wtime() - barrier_start);
+        }
+
+        // exchange packed halo rows with the neighboring strips; the rows
+        // go out in place, so there is nothing to pack
+        double comm_start = MPI_Wtime();
+        if (p != 1)
+        {
+            MPI_Request* set = requests[board == planes[0] ? 0 : 1];
+            MPI_Startall(4, set);
+            MPI_Waitall(4, set, MPI_STATUSES_IGNORE);
+        }
+        else
+        {
+            memcpy(&board[0], &board[rows*WORDS], sizeof(uint64_t)*WORDS);
+            memcpy(&board[(rows+1)*WORDS], &board[WORDS], sizeof(uint64_t)*WORDS);
+        }
+        double comm_end = MPI_Wtime();
+        total_comm_time += comm_end - comm_start;
+        TimingAdd(TIMER_WAIT, comm_end - comm_start);
+
+        // prime the rolling window with ghost row 0 and row 1
+        ShiftWest(&board[0], &west[0]);
+        ShiftEast(&board[0], &east[0]);
+        ShiftWest(&board[WORDS], &west[WORDS]);
+        ShiftEast(&board[WORDS], &east[WORDS]);
+
+        for (int x = 1; x <= rows; x++)
+        {
+            int a = (x-1) % 3, m = x % 3, b = (x+1) % 3;
+            ShiftWest(&board[(x+1)*WORDS], &west[b*WORDS]);
+            ShiftEast(&board[(x+1)*WORDS], &east[b*WORDS]);
+
+            StepRow(&west[a*WORDS], &board[(x-1)*WORDS], &east[a*WORDS],
+                    &west[m*WORDS], &board[x*WORDS], &east[m*WORDS],
+                    &west[b*WORDS], &board[(x+1)*WORDS], &east[b*WORDS],
+                    &new_board[x*WORDS]);
+        }
+
+        uint64_t* tmp = board;
+        board = new_board;
+        new_board = tmp;
+        TimingAdd(TIMER_COMPUTE, MPI_Wtime() - comm_end);
+        TimingEndGeneration();
+
+        if (__DEBUG__)
+        {
+            printf("Process %d has finished packed iteration %d\n", rank, i);
+        }
+
+        // stop as soon as the board repeats a recent generation
+        if (opts->detect_period > 0 && PackedDetect(board, rank, p, i + 1))
+        {
+            break;
+        }
+    }
+
+    if (opts->detect_period > 0)
+    {
+        DetectFree();
+    }
+
+    if (opts->print_board)
+    {
+        PrintBoardPacked(board, rank, p);
+    }
+
+    for (int b = 0; b < 2 && p != 1; b++)
+    {
+        for (int r = 0; r < 4; r++)
+        {
+            MPI_Request_free(&requests[b][r]);
+        }
+    }
+
+    GolFree(&board_block);
+    GolFree(&new_board_block);
+    free(west);
+    free(east);
+}
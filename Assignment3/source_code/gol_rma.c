@@ -0,0 +1,104 @@
+/*
+* Ethan Vincent
+* One-sided halo transport: every proc puts its edges straight into its
+* neighbors' ghost frames with MPI_Put, synchronized by post-start-
+* complete-wait among the neighbors, so there is no receive to match and
+* no rendezvous handshake per edge
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+/*
+* Move this proc's boards into window memory from MPI_Win_allocate, which
+* the library can register with the interconnect once, and build the
+* target type of each put: the ghost region of the neighbor in direction
+* d that faces us, in that neighbor's own layout (collective over the
+* cart). Call before HaloSetTypes.
+*/
+void HaloExposeGrid(GolHalo* halo, GolGrid* grid)
+{
+    // only post/start/complete/wait touch the window, never a lock
+    MPI_Info info;
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "no_locks", "true");
+    uint8_t* base = NULL;
+    MPI_Win_allocate(2*grid->plane, 1, info, halo->cart, &base, &halo->window);
+    MPI_Info_free(&info);
+
+    GolFree(&grid->storage);
+    halo->window_base = base;
+    grid->cur = base;
+    grid->next = base + grid->plane;
+
+    // neighbor blocks follow the same split as ours, so their shapes are known here
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        int r = (halo->coords[0] + HALO_OFFSETS[d][0] + halo->dims[0]) % halo->dims[0];
+        int c = (halo->coords[1] + HALO_OFFSETS[d][1] + halo->dims[1]) % halo->dims[1];
+        int rows = BlockSize(HEIGHT, halo->dims[0], r);
+        int cols = BlockSize(WIDTH, halo->dims[1], c);
+        HaloSubarray(rows, cols, grid->ghost, GridStride(cols, grid->ghost), HALO_DIRECTIONS-1-d, 1, &halo->put_types[d]);
+        halo->put_planes[d] = (MPI_Aint)(rows + 2*grid->ghost)*GridStride(cols, grid->ghost);
+    }
+
+    // small process grids repeat neighbors, and a group lists each rank once
+    int ranks[HALO_DIRECTIONS], n = 0;
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        int seen = 0;
+        for (int k = 0; k < n; k++)
+        {
+            seen |= ranks[k] == halo->neighbors[d];
+        }
+        if (!seen)
+        {
+            ranks[n++] = halo->neighbors[d];
+        }
+    }
+    MPI_Group cart_group;
+    MPI_Comm_group(halo->cart, &cart_group);
+    MPI_Group_incl(cart_group, n, ranks, &halo->neighbor_group);
+    MPI_Group_free(&cart_group);
+
+    halo_transport_name = "rma";
+}
+
+/*
+* Open this exchange: expose our ghost frame to the neighbors, then put
+* our eight edges into theirs. Every proc swaps boards the same number of
+* times between exchanges, so the neighbor's current board is the same one
+* of its two as ours is of ours.
+*/
+void HaloPutBegin(GolHalo* halo, GolGrid* grid)
+{
+    int second = grid->cur != halo->window_base;
+
+    MPI_Win_post(halo->neighbor_group, 0, halo->window);
+    MPI_Win_start(halo->neighbor_group, 0, halo->window);
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        MPI_Put(grid->cur, 1, halo->send_types[d], halo->neighbors[d], second ? halo->put_planes[d] : 0, 1, halo->put_types[d], halo->window);
+    }
+}
+
+// our puts are done and every neighbor's puts into our ghost frame have landed
+void HaloPutEnd(GolHalo* halo)
+{
+    MPI_Win_complete(halo->window);
+    MPI_Win_wait(halo->window);
+}
+
+void HaloExposeFree(GolHalo* halo)
+{
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        MPI_Type_free(&halo->put_types[d]);
+    }
+    MPI_Group_free(&halo->neighbor_group);
+    MPI_Win_free(&halo->window);
+}
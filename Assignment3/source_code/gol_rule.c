@@ -0,0 +1,202 @@
+/*
+* Ethan Vincent
+* Life-like rules in B/S notation ("B3/S23" is Conway's Life): parsed once
+* at startup into a lookup table every engine indexes by (state, count)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gol.h"
+
+// the rule this program has always run: alive next iff 2 < neighbor_sum < 6
+#define DEFAULT_BIRTH 0x038
+#define DEFAULT_SURVIVE 0x038
+
+GolRule RULE = {DEFAULT_BIRTH, DEFAULT_SURVIVE, 1, 0, 0, 0, 0, 0, "B345/S345"};
+uint8_t RULE_TABLE[2][9] = {{0, 0, 0, 1, 1, 1, 0, 0, 0}, {0, 0, 0, 1, 1, 1, 0, 0, 0}};
+
+// digits 0-8 after a B or S, up to the next '/' or the end
+static const char* ParseCounts(const char* s, uint16_t* mask)
+{
+    *mask = 0;
+    while (*s >= '0' && *s <= '8')
+    {
+        *mask |= 1u << (*s - '0');
+        s++;
+    }
+    return s;
+}
+
+// the largest radius whose box counts fit the engine's 16-bit column sums
+#define LTL_MAX_RADIUS 127
+
+// "<min>..<max>" of box counts
+static const char* ParseRange(const char* s, int* min, int* max)
+{
+    char* end;
+    *min = (int)strtol(s, &end, 10);
+    if (end == s || end[0] != '.' || end[1] != '.')
+    {
+        return NULL;
+    }
+    s = end + 2;
+    *max = (int)strtol(s, &end, 10);
+    return end == s ? NULL : end;
+}
+
+/*
+* Larger than Life in Golly's notation, e.g. "R5,C0,M1,S34..58,B34..45,NM"
+* (Bosco's rule): radius, states (0 or 2, both meaning two), whether the
+* count includes the middle cell, survive and birth count ranges, and the
+* Moore neighborhood, the only one whose box sums separate by axis.
+*/
+static int ParseLtlRule(const char* text)
+{
+    int radius = 0, states = 0, middle = 0, smin = 0, smax = -1, bmin = 0, bmax = -1, moore = 0;
+    const char* s = text;
+    while (*s != '\0')
+    {
+        char* end = (char*)s + 1;
+        switch (*s)
+        {
+            case 'R': case 'r': radius = (int)strtol(s + 1, &end, 10); break;
+            case 'C': case 'c': states = (int)strtol(s + 1, &end, 10); break;
+            case 'M': case 'm': middle = (int)strtol(s + 1, &end, 10); break;
+            case 'S': case 's': end = (char*)ParseRange(s + 1, &smin, &smax); break;
+            case 'B': case 'b': end = (char*)ParseRange(s + 1, &bmin, &bmax); break;
+            case 'N': case 'n':
+                // NM (Moore) or NN (von Neumann, rejected below); a bare N ends the string
+                if (s[1] != 'M' && s[1] != 'm' && s[1] != 'N' && s[1] != 'n')
+                {
+                    return -1;
+                }
+                moore = s[1] == 'M' || s[1] == 'm';
+                end = (char*)s + 2;
+                break;
+            default: return -1;
+        }
+        if (end == NULL || (*end != ',' && *end != '\0'))
+        {
+            return -1;
+        }
+        s = *end == ',' ? end + 1 : end;
+    }
+
+    int max_count = (2*radius + 1)*(2*radius + 1);
+    if (radius < 1 || radius > LTL_MAX_RADIUS || (states != 0 && states != 2) || (middle != 0 && middle != 1) ||
+        !moore || smin < 0 || smax >= max_count || bmin < 0 || bmax >= max_count)
+    {
+        return -1;
+    }
+
+    RULE.radius = radius;
+    RULE.middle = middle;
+    RULE.survive_min = smin;
+    RULE.survive_max = smax;
+    RULE.birth_min = bmin;
+    RULE.birth_max = bmax;
+    RULE.birth = 0;
+    RULE.survive = 0;
+    snprintf(RULE.name, sizeof(RULE.name), "R%d,C0,M%d,S%d..%d,B%d..%d,NM", radius, middle, smin, smax, bmin, bmax);
+
+    // radius 1 still runs the 3x3 kernels: the ranges become count masks
+    if (radius == 1)
+    {
+        for (int c = 0; c <= 8; c++)
+        {
+            int survive_count = c + middle, birth_count = c;
+            RULE_TABLE[0][c] = birth_count >= bmin && birth_count <= bmax;
+            RULE_TABLE[1][c] = survive_count >= smin && survive_count <= smax;
+            RULE.birth |= RULE_TABLE[0][c] << c;
+            RULE.survive |= RULE_TABLE[1][c] << c;
+        }
+    }
+    return 0;
+}
+
+/*
+* Parse "B<digits>/S<digits>" (either half may come first, either may be
+* empty) or a Larger than Life rule into RULE and RULE_TABLE. Returns 0,
+* or -1 if text is not a rule.
+*/
+int ParseRule(const char* text)
+{
+    if (strchr(text, ',') != NULL)
+    {
+        return ParseLtlRule(text);
+    }
+
+    uint16_t birth = 0, survive = 0;
+    int seen_birth = 0, seen_survive = 0;
+    const char* s = text;
+
+    while (*s != '\0')
+    {
+        if ((*s == 'B' || *s == 'b') && !seen_birth)
+        {
+            s = ParseCounts(s + 1, &birth);
+            seen_birth = 1;
+        }
+        else if ((*s == 'S' || *s == 's') && !seen_survive)
+        {
+            s = ParseCounts(s + 1, &survive);
+            seen_survive = 1;
+        }
+        else
+        {
+            return -1;
+        }
+
+        if (*s == '/')
+        {
+            s++;
+        }
+        else if (*s != '\0')
+        {
+            return -1;
+        }
+    }
+    if (!seen_birth || !seen_survive)
+    {
+        return -1;
+    }
+
+    RULE.birth = birth;
+    RULE.survive = survive;
+    RULE.radius = 1;
+
+    // canonical name, counts in ascending order
+    char* out = RULE.name;
+    *out++ = 'B';
+    for (int c = 0; c <= 8; c++)
+    {
+        if (birth & (1u << c))
+        {
+            *out++ = '0' + c;
+        }
+    }
+    *out++ = '/';
+    *out++ = 'S';
+    for (int c = 0; c <= 8; c++)
+    {
+        if (survive & (1u << c))
+        {
+            *out++ = '0' + c;
+        }
+    }
+    *out = '\0';
+
+    for (int c = 0; c <= 8; c++)
+    {
+        RULE_TABLE[0][c] = (birth >> c) & 1;
+        RULE_TABLE[1][c] = (survive >> c) & 1;
+    }
+    return 0;
+}
+
+int RuleIsDefault(void)
+{
+    return RULE.radius == 1 && RULE.birth == DEFAULT_BIRTH && RULE.survive == DEFAULT_SURVIVE;
+}
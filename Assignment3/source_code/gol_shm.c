@@ -0,0 +1,180 @@
+/*
+* Ethan Vincent
+* Shared-memory halo transport: the boards of all procs on a node live in
+* one MPI-3 shared window, so ghost cells from a neighbor on the same node
+* are read straight out of that neighbor's board, with no packing or
+* message; only edges to procs on other nodes still go through MPI
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+/*
+* Every proc's segment of the window starts with this header, followed by
+* its two boards. published = e once the board at cur_offset holds the
+* generation of exchange e; copied = e once this proc has filled its ghost
+* cells for exchange e, so its neighbors may write over that board again.
+*/
+struct GolShmHeader
+{
+    uint64_t published;
+    uint64_t copied;
+    size_t cur_offset;      // published board, in bytes from the first board
+    int rows;
+    int cols;
+    int ghost;
+    int stride;
+};
+
+// keeps the boards behind the header cache-line aligned
+#define SHM_HEADER_BYTES 64
+
+static uint8_t* Boards(struct GolShmHeader* header)
+{
+    return (uint8_t*)header + SHM_HEADER_BYTES;
+}
+
+/*
+* Move this proc's boards into the node's shared window and find which of
+* its eight neighbors are on the same node (collective over the cart).
+* Call before HaloSetTypes so the messaged edges are the only requests.
+*/
+void HaloShareGrid(GolHalo* halo, GolGrid* grid)
+{
+    MPI_Comm_split_type(halo->cart, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &halo->node);
+
+    MPI_Group cart_group, node_group;
+    MPI_Comm_group(halo->cart, &cart_group);
+    MPI_Comm_group(halo->node, &node_group);
+    MPI_Group_translate_ranks(cart_group, HALO_DIRECTIONS, halo->neighbors, node_group, halo->node_ranks);
+    MPI_Group_free(&cart_group);
+    MPI_Group_free(&node_group);
+
+    // separate segments let each proc's boards land on its own NUMA node
+    MPI_Info info;
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "alloc_shared_noncontig", "true");
+    uint8_t* base = NULL;
+    MPI_Win_allocate_shared(SHM_HEADER_BYTES + 2*grid->plane, 1, info, halo->node, &base, &halo->window);
+    MPI_Info_free(&info);
+
+    GolFree(&grid->storage);
+    halo->shm_header = (struct GolShmHeader*)base;
+    grid->cur = Boards(halo->shm_header);
+    grid->next = grid->cur + grid->plane;
+
+    struct GolShmHeader* me = halo->shm_header;
+    me->published = 0;
+    me->copied = 0;
+    me->cur_offset = 0;
+    me->rows = grid->rows;
+    me->cols = grid->cols;
+    me->ghost = grid->ghost;
+    me->stride = grid->stride;
+
+    // one passive epoch for the whole run; MPI_Win_sync orders our loads and stores
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, halo->window);
+    MPI_Win_sync(halo->window);
+    MPI_Barrier(halo->node);
+    MPI_Win_sync(halo->window);
+
+    int shared = 0;
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        if (halo->node_ranks[d] != MPI_UNDEFINED)
+        {
+            MPI_Aint size;
+            int disp;
+            void* segment;
+            MPI_Win_shared_query(halo->window, halo->node_ranks[d], &size, &disp, &segment);
+            halo->shm_neighbors[d] = (struct GolShmHeader*)segment;
+            shared++;
+        }
+    }
+
+    int p, total = 0;
+    MPI_Comm_size(halo->cart, &p);
+    MPI_Allreduce(&shared, &total, 1, MPI_INT, MPI_SUM, halo->cart);
+    halo_shared_fraction = (double)total/(HALO_DIRECTIONS*p);
+    halo_transport_name = "shm";
+}
+
+static void WaitFor(uint64_t* counter, uint64_t epoch)
+{
+    while (__atomic_load_n(counter, __ATOMIC_ACQUIRE) < epoch)
+    {
+        // procs may share a core, so let the one we wait on run
+        sched_yield();
+    }
+}
+
+// announce that the current board is this exchange's generation
+void HaloSharedPublish(GolHalo* halo, GolGrid* grid)
+{
+    struct GolShmHeader* me = halo->shm_header;
+    halo->epoch++;
+    me->cur_offset = grid->cur - Boards(me);
+
+    // the board and its offset are visible before the new count is
+    MPI_Win_sync(halo->window);
+    __atomic_store_n(&me->published, halo->epoch, __ATOMIC_RELEASE);
+}
+
+// fill each same-node ghost region straight from the neighbor's owned edge
+void HaloSharedCopy(GolHalo* halo, GolGrid* grid)
+{
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        struct GolShmHeader* neighbor = halo->shm_neighbors[d];
+        if (neighbor == NULL)
+        {
+            continue;
+        }
+        WaitFor(&neighbor->published, halo->epoch);
+        MPI_Win_sync(halo->window);
+
+        // our ghost rows above us are the neighbor's last rows, those below its first
+        int r0, r1, c0, c1;
+        HaloRegion(grid, d, 1, &r0, &r1, &c0, &c1);
+        int dr = HALO_OFFSETS[d][0] < 0 ? neighbor->rows : (HALO_OFFSETS[d][0] > 0 ? -grid->rows : 0);
+        int dc = HALO_OFFSETS[d][1] < 0 ? neighbor->cols : (HALO_OFFSETS[d][1] > 0 ? -grid->cols : 0);
+
+        uint8_t* board = Boards(neighbor) + neighbor->cur_offset;
+        for (int r = r0; r < r1; r++)
+        {
+            uint8_t* src = board + (size_t)(r + dr + neighbor->ghost)*neighbor->stride + neighbor->ghost + c0 + dc;
+            memcpy(GridRow(grid, grid->cur, r) + c0, src, c1 - c0);
+        }
+    }
+}
+
+/*
+* Neighbors on this node read our published board until they report
+* copied; wait for them before a step overwrites it. With a deep halo the
+* next step that writes that board needs no exchange, so this is the only
+* thing holding it back.
+*/
+void HaloSharedDone(GolHalo* halo)
+{
+    __atomic_store_n(&halo->shm_header->copied, halo->epoch, __ATOMIC_RELEASE);
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        if (halo->shm_neighbors[d] != NULL)
+        {
+            WaitFor(&halo->shm_neighbors[d]->copied, halo->epoch);
+        }
+    }
+    MPI_Win_sync(halo->window);
+}
+
+void HaloSharedFree(GolHalo* halo)
+{
+    MPI_Win_unlock_all(halo->window);
+    MPI_Win_free(&halo->window);
+    MPI_Comm_free(&halo->node);
+}
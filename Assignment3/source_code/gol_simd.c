@@ -0,0 +1,249 @@
+/*
+* Ethan Vincent
+* Row kernels for the grid engine: scalar, AVX2 and AVX-512, picked at
+* runtime from what the CPU supports so one binary runs on every node.
+* Common rules get kernels with the rule compiled in; any other rule runs
+* through a lookup table.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <immintrin.h>
+
+#include "gol.h"
+
+/*
+* Branch-free stencil over one row: every neighbor is a plain load because
+* the ghost frame holds the halo and the neighbors' edge cells.
+*/
+static void StepRowScalar(const uint8_t* above, const uint8_t* mid, const uint8_t* below, uint8_t* out, int n)
+{
+    for (int j = 0; j < n; j++)
+    {
+        uint8_t neighbor_sum = above[j-1] + above[j] + above[j+1]
+                             + mid[j-1] + mid[j+1]
+                             + below[j-1] + below[j] + below[j+1];
+
+        // alive when 2 < neighbor_sum < 6 (B345/S345)
+        out[j] = (uint8_t)(neighbor_sum - 3) <= 2;
+    }
+}
+
+// any rule: one RULE_TABLE load per cell
+static void StepRowTable(const uint8_t* above, const uint8_t* mid, const uint8_t* below, uint8_t* out, int n)
+{
+    for (int j = 0; j < n; j++)
+    {
+        int neighbor_sum = above[j-1] + above[j] + above[j+1]
+                         + mid[j-1] + mid[j+1]
+                         + below[j-1] + below[j] + below[j+1];
+        out[j] = RULE_TABLE[mid[j]][neighbor_sum];
+    }
+}
+
+/*
+* Scalar kernel with the birth and survive masks as constants: the cell's
+* state picks a mask without a branch and the count selects its bit.
+*/
+#define RULE_KERNEL(name, birth, survive) \
+static void name(const uint8_t* above, const uint8_t* mid, const uint8_t* below, uint8_t* out, int n) \
+{ \
+    for (int j = 0; j < n; j++) \
+    { \
+        int neighbor_sum = above[j-1] + above[j] + above[j+1] \
+                         + mid[j-1] + mid[j+1] \
+                         + below[j-1] + below[j] + below[j+1]; \
+        int mask = (birth) ^ (((birth) ^ (survive)) & -(int)mid[j]); \
+        out[j] = (mask >> neighbor_sum) & 1; \
+    } \
+}
+
+RULE_KERNEL(StepRowConway, 0x008, 0x00c)      // B3/S23
+RULE_KERNEL(StepRowHighLife, 0x048, 0x00c)    // B36/S23
+RULE_KERNEL(StepRowSeeds, 0x004, 0x000)       // B2/S
+RULE_KERNEL(StepRowDayNight, 0x1c8, 0x1d8)    // B3678/S34678
+
+static const struct
+{
+    uint16_t birth;
+    uint16_t survive;
+    GolRowKernel kernel;
+} SPECIALIZED_RULES[] =
+{
+    {0x038, 0x038, StepRowScalar},
+    {0x008, 0x00c, StepRowConway},
+    {0x048, 0x00c, StepRowHighLife},
+    {0x004, 0x000, StepRowSeeds},
+    {0x1c8, 0x1d8, StepRowDayNight},
+};
+
+// RULE_TABLE rows padded to 16 bytes for the byte shuffles below
+static uint8_t birth_bytes[16] __attribute__((aligned(16)));
+static uint8_t survive_bytes[16] __attribute__((aligned(16)));
+
+// 32 cells per iteration; the same unsigned (sum - 3) <= 2 test as the scalar kernel
+__attribute__((target("avx2")))
+static void StepRowAVX2(const uint8_t* above, const uint8_t* mid, const uint8_t* below, uint8_t* out, int n)
+{
+    const __m256i three = _mm256_set1_epi8(3);
+    const __m256i two = _mm256_set1_epi8(2);
+    const __m256i one = _mm256_set1_epi8(1);
+
+    int j = 0;
+    for (; j + 32 <= n; j += 32)
+    {
+        __m256i sum = _mm256_loadu_si256((const __m256i*)&above[j-1]);
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&above[j]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&above[j+1]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&mid[j-1]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&mid[j+1]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&below[j-1]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&below[j]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&below[j+1]));
+
+        // x <= 2 (unsigned) exactly when min(x, 2) == x
+        __m256i x = _mm256_sub_epi8(sum, three);
+        __m256i alive = _mm256_cmpeq_epi8(_mm256_min_epu8(x, two), x);
+        _mm256_storeu_si256((__m256i*)&out[j], _mm256_and_si256(alive, one));
+    }
+
+    StepRowScalar(above + j, mid + j, below + j, out + j, n - j);
+}
+
+// 64 cells per iteration; byte adds and compares need AVX-512BW
+__attribute__((target("avx512f,avx512bw")))
+static void StepRowAVX512(const uint8_t* above, const uint8_t* mid, const uint8_t* below, uint8_t* out, int n)
+{
+    const __m512i three = _mm512_set1_epi8(3);
+    const __m512i two = _mm512_set1_epi8(2);
+    const __m512i one = _mm512_set1_epi8(1);
+
+    int j = 0;
+    for (; j + 64 <= n; j += 64)
+    {
+        __m512i sum = _mm512_loadu_si512(&above[j-1]);
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&above[j]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&above[j+1]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&mid[j-1]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&mid[j+1]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&below[j-1]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&below[j]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&below[j+1]));
+
+        __mmask64 alive = _mm512_cmple_epu8_mask(_mm512_sub_epi8(sum, three), two);
+        _mm512_storeu_si512(&out[j], _mm512_maskz_mov_epi8(alive, one));
+    }
+
+    StepRowScalar(above + j, mid + j, below + j, out + j, n - j);
+}
+
+/*
+* Any rule, 32 cells per iteration: the counts index both 16-entry tables
+* with a byte shuffle, and the cell's 0/1 state picks between the results.
+*/
+__attribute__((target("avx2")))
+static void StepRowTableAVX2(const uint8_t* above, const uint8_t* mid, const uint8_t* below, uint8_t* out, int n)
+{
+    const __m256i birth = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)birth_bytes));
+    const __m256i survive = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)survive_bytes));
+
+    int j = 0;
+    for (; j + 32 <= n; j += 32)
+    {
+        __m256i sum = _mm256_loadu_si256((const __m256i*)&above[j-1]);
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&above[j]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&above[j+1]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&mid[j-1]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&mid[j+1]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&below[j-1]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&below[j]));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i*)&below[j+1]));
+
+        __m256i self = _mm256_loadu_si256((const __m256i*)&mid[j]);
+        __m256i b = _mm256_shuffle_epi8(birth, sum);
+        __m256i s = _mm256_shuffle_epi8(survive, sum);
+        _mm256_storeu_si256((__m256i*)&out[j], _mm256_xor_si256(b, _mm256_and_si256(_mm256_xor_si256(b, s), self)));
+    }
+
+    StepRowTable(above + j, mid + j, below + j, out + j, n - j);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void StepRowTableAVX512(const uint8_t* above, const uint8_t* mid, const uint8_t* below, uint8_t* out, int n)
+{
+    const __m512i birth = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i*)birth_bytes));
+    const __m512i survive = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i*)survive_bytes));
+
+    int j = 0;
+    for (; j + 64 <= n; j += 64)
+    {
+        __m512i sum = _mm512_loadu_si512(&above[j-1]);
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&above[j]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&above[j+1]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&mid[j-1]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&mid[j+1]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&below[j-1]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&below[j]));
+        sum = _mm512_add_epi8(sum, _mm512_loadu_si512(&below[j+1]));
+
+        __m512i self = _mm512_loadu_si512(&mid[j]);
+        __m512i b = _mm512_shuffle_epi8(birth, sum);
+        __m512i s = _mm512_shuffle_epi8(survive, sum);
+        _mm512_storeu_si512(&out[j], _mm512_xor_si512(b, _mm512_and_si512(_mm512_xor_si512(b, s), self)));
+    }
+
+    StepRowTable(above + j, mid + j, below + j, out + j, n - j);
+}
+
+/*
+* Resolve --kernel and RULE to a row kernel. "auto" takes the widest one
+* this CPU supports; asking for an unsupported one falls back to scalar.
+* The vector kernels have the default rule compiled in and use the shuffle
+* tables for every other rule; the scalar ones cover a few more rules.
+*/
+GolRowKernel SelectRowKernel(const char* kernel, const char** name)
+{
+    __builtin_cpu_init();
+    int has_avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    int has_avx2 = __builtin_cpu_supports("avx2");
+
+    memset(birth_bytes, 0, sizeof(birth_bytes));
+    memset(survive_bytes, 0, sizeof(survive_bytes));
+    memcpy(birth_bytes, RULE_TABLE[0], 9);
+    memcpy(survive_bytes, RULE_TABLE[1], 9);
+
+    // a wide stencil steps through gol_ltl.c, never a row kernel
+    if (RULE.radius > 1)
+    {
+        *name = "scalar";
+        rule_kernel = "sliding-window";
+        return StepRowTable;
+    }
+
+    int specialized = RuleIsDefault();
+    rule_kernel = specialized ? "specialized" : "table";
+
+    int want_auto = strcmp(kernel, "auto") == 0;
+    if ((want_auto || strcmp(kernel, "avx512") == 0) && has_avx512)
+    {
+        *name = "avx512";
+        return specialized ? StepRowAVX512 : StepRowTableAVX512;
+    }
+    if ((want_auto || strcmp(kernel, "avx2") == 0) && has_avx2)
+    {
+        *name = "avx2";
+        return specialized ? StepRowAVX2 : StepRowTableAVX2;
+    }
+
+    *name = "scalar";
+    for (size_t r = 0; r < sizeof(SPECIALIZED_RULES)/sizeof(SPECIALIZED_RULES[0]); r++)
+    {
+        if (SPECIALIZED_RULES[r].birth == RULE.birth && SPECIALIZED_RULES[r].survive == RULE.survive)
+        {
+            rule_kernel = "specialized";
+            return SPECIALIZED_RULES[r].kernel;
+        }
+    }
+    return StepRowTable;
+}
@@ -0,0 +1,189 @@
+/*
+* Ethan Vincent
+* Active-tile tracking for the grid engine: tiles whose 3x3 tile
+* neighborhood did not change last generation are left alone, and block
+* edges that did not change are not resent
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+void TilesCreate(GolTiles* tiles, GolGrid* grid, int size)
+{
+    tiles->size = size;
+    tiles->tile_rows = (grid->rows + size - 1)/size;
+    tiles->tile_cols = (grid->cols + size - 1)/size;
+
+    // every tile counts as changed until it has been computed once
+    int count = tiles->tile_rows*tiles->tile_cols;
+    tiles->changed = (uint8_t*)malloc(count);
+    tiles->changed_next = (uint8_t*)malloc(count);
+    memset(tiles->changed, 1, count);
+
+    tiles->tiles_updated = 0.0;
+    tiles->tiles_total = 0.0;
+    tiles->edges_skipped = 0.0;
+    tiles->edges_total = 0.0;
+}
+
+void TilesFree(GolTiles* tiles)
+{
+    free(tiles->changed);
+    free(tiles->changed_next);
+}
+
+// did any tile overlapping owned cells [r0, r1) x [c0, c1) change last generation
+static int AnyTileChanged(GolTiles* tiles, int r0, int r1, int c0, int c1)
+{
+    int t = tiles->size;
+    for (int ti = r0/t; ti <= (r1 - 1)/t; ti++)
+    {
+        for (int tj = c0/t; tj <= (c1 - 1)/t; tj++)
+        {
+            if (tiles->changed[ti*tiles->tile_cols + tj])
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void CopyRegion(GolGrid* grid, uint8_t* from, uint8_t* to, int r0, int r1, int c0, int c1)
+{
+    for (int i = r0; i < r1; i++)
+    {
+        memcpy(GridRow(grid, to, i) + c0, GridRow(grid, from, i) + c0, c1 - c0);
+    }
+}
+
+// do the ghost cells inside [r0, r1) x [c0, c1) differ between the two generations
+static int GhostChanged(GolGrid* grid, int r0, int r1, int c0, int c1)
+{
+    for (int i = r0; i < r1; i++)
+    {
+        uint8_t* now = GridRow(grid, grid->cur, i);
+        uint8_t* before = GridRow(grid, grid->next, i);
+        if (i < 0 || i >= grid->rows)
+        {
+            if (memcmp(now + c0, before + c0, c1 - c0) != 0)
+            {
+                return 1;
+            }
+        }
+        else if ((c0 < 0 && now[c0] != before[c0]) || (c1 > grid->cols && now[c1-1] != before[c1-1]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// do owned cells [r0, r1) x [c0, c1) differ between the two boards
+static int RegionChanged(GolGrid* grid, int r0, int r1, int c0, int c1)
+{
+    for (int i = r0; i < r1; i++)
+    {
+        if (memcmp(GridRow(grid, grid->cur, i) + c0, GridRow(grid, grid->next, i) + c0, c1 - c0) != 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+* One generation with active tiles. A skipped tile needs no copy: its cells
+* in the next board are from two generations back, which equal the current
+* ones because the tile did not change last generation.
+*/
+void TilesStep(GolTiles* tiles, GolGrid* grid, GolHalo* halo)
+{
+    int t = tiles->size;
+    int tile_rows = tiles->tile_rows, tile_cols = tiles->tile_cols;
+
+    // only resend edges that have a changed tile behind them
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        int r0, r1, c0, c1;
+        HaloRegion(grid, d, 0, &r0, &r1, &c0, &c1);
+        halo->send_counts[d] = AnyTileChanged(tiles, r0, r1, c0, c1);
+    }
+
+    double comm_start = MPI_Wtime();
+    HaloBegin(halo, grid);
+    double wait_start = MPI_Wtime();
+    HaloEnd(halo, grid);
+    double comm_end = MPI_Wtime();
+    total_comm_time += comm_end - comm_start;
+    TimingAdd(TIMER_PACK, wait_start - comm_start);
+    TimingAdd(TIMER_WAIT, comm_end - wait_start);
+
+    // an empty message means the neighbor's edge equals what we received last time
+    for (int d = 0; d < HALO_DIRECTIONS; d++)
+    {
+        int count = 0;
+        MPI_Get_count(&halo->statuses[d], halo->recv_types[d], &count);
+        if (count == 0)
+        {
+            int r0, r1, c0, c1;
+            HaloRegion(grid, d, 1, &r0, &r1, &c0, &c1);
+            CopyRegion(grid, grid->next, grid->cur, r0, r1, c0, c1);
+            tiles->edges_skipped++;
+        }
+    }
+    tiles->edges_total += HALO_DIRECTIONS;
+
+    double updated = 0.0;
+
+    #pragma omp parallel for schedule(dynamic) reduction(+:updated)
+    for (int k = 0; k < tile_rows*tile_cols; k++)
+    {
+        int ti = k/tile_cols, tj = k%tile_cols;
+        int r0 = ti*t, r1 = (r0 + t < grid->rows) ? r0 + t : grid->rows;
+        int c0 = tj*t, c1 = (c0 + t < grid->cols) ? c0 + t : grid->cols;
+
+        int active = 0;
+        for (int a = ti - 1; a <= ti + 1 && !active; a++)
+        {
+            for (int b = tj - 1; b <= tj + 1; b++)
+            {
+                if (a >= 0 && a < tile_rows && b >= 0 && b < tile_cols && tiles->changed[a*tile_cols + b])
+                {
+                    active = 1;
+                    break;
+                }
+            }
+        }
+
+        // tiles on the block edge also depend on the ghost frame
+        if (!active && (ti == 0 || tj == 0 || ti == tile_rows - 1 || tj == tile_cols - 1))
+        {
+            active = GhostChanged(grid, r0 - 1, r1 + 1, c0 - 1, c1 + 1);
+        }
+
+        if (active)
+        {
+            GridStepRegion(grid, r0, r1, c0, c1);
+            tiles->changed_next[k] = RegionChanged(grid, r0, r1, c0, c1);
+            updated++;
+        }
+        else
+        {
+            tiles->changed_next[k] = 0;
+        }
+    }
+
+    TimingAdd(TIMER_COMPUTE, MPI_Wtime() - comm_end);
+    tiles->tiles_updated += updated;
+    tiles->tiles_total += tile_rows*tile_cols;
+
+    uint8_t* tmp = tiles->changed;
+    tiles->changed = tiles->changed_next;
+    tiles->changed_next = tmp;
+}
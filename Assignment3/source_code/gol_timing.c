@@ -0,0 +1,180 @@
+/*
+* Ethan Vincent
+* Per-generation phase timers: every generation's halo pack, exchange
+* wait, compute and barrier times on every rank, reduced to min/mean/max/p99
+* and a load-imbalance ratio, printed as text, JSON or CSV
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <mpi.h>
+
+#include "gol.h"
+
+const char* TIMER_NAMES[TIMER_COUNT] = {"pack", "wait", "compute", "barrier", "generation"};
+
+/*
+* Samples go into log-spaced histogram bins (50 per decade from 10 ns to
+* 1000 s) instead of being kept, so memory does not grow with the number
+* of generations and the histograms of all ranks merge with one MPI_Reduce.
+* p99 is read back to within a bin width, about 5%.
+*/
+#define BINS_PER_DECADE 50
+#define BIN_DECADE_MIN -8
+#define TIMING_BINS (11*BINS_PER_DECADE)
+
+typedef struct
+{
+    double min;
+    double max;
+    double sum;
+    double count;
+    double bins[TIMING_BINS];
+} GolTimer;
+
+static GolTimer timers[TIMER_COUNT];
+static double current[TIMER_COUNT];    // phases of the generation in progress
+static double generation_start = 0.0;
+
+void TimingReset(void)
+{
+    for (int t = 0; t < TIMER_COUNT; t++)
+    {
+        memset(&timers[t], 0, sizeof(GolTimer));
+        timers[t].min = 1e300;
+        current[t] = 0.0;
+    }
+}
+
+void TimingBeginGeneration(void)
+{
+    generation_start = MPI_Wtime();
+}
+
+void TimingAdd(int timer, double seconds)
+{
+    current[timer] += seconds;
+}
+
+static void Record(GolTimer* timer, double seconds)
+{
+    timer->min = seconds < timer->min ? seconds : timer->min;
+    timer->max = seconds > timer->max ? seconds : timer->max;
+    timer->sum += seconds;
+    timer->count++;
+
+    int bin = 0;
+    if (seconds > 0.0)
+    {
+        bin = (int)((log10(seconds) - BIN_DECADE_MIN)*BINS_PER_DECADE);
+        bin = bin < 0 ? 0 : (bin >= TIMING_BINS ? TIMING_BINS - 1 : bin);
+    }
+    timer->bins[bin]++;
+}
+
+// close the generation started by TimingBeginGeneration and start the next one
+void TimingEndGeneration(void)
+{
+    TimingEndGenerations(1);
+}
+
+// close n generations that were computed together (temporal blocking);
+// the batch's wall time and phases are split evenly between them
+void TimingEndGenerations(int n)
+{
+    double now = MPI_Wtime();
+    current[TIMER_GENERATION] = now - generation_start;
+    for (int t = 0; t < TIMER_COUNT; t++)
+    {
+        for (int k = 0; k < n; k++)
+        {
+            Record(&timers[t], current[t]/n);
+        }
+        current[t] = 0.0;
+    }
+    generation_start = now;
+}
+
+// upper edge of the bin holding the 99th percentile sample, capped at the max
+static double Percentile99(const GolTimer* timer)
+{
+    double target = 0.99*timer->count, seen = 0.0;
+    for (int b = 0; b < TIMING_BINS; b++)
+    {
+        seen += timer->bins[b];
+        if (seen >= target && seen > 0.0)
+        {
+            double edge = pow(10.0, BIN_DECADE_MIN + (double)(b + 1)/BINS_PER_DECADE);
+            return edge < timer->max ? edge : timer->max;
+        }
+    }
+    return 0.0;
+}
+
+/*
+* Reduce every timer over ranks and generations (collective). Results are
+* valid on rank 0; stats[t] = {min, mean, max, p99} in seconds and
+* rank_sums[r*TIMER_COUNT + t] is rank r's total for timer t.
+*/
+void TimingReduce(GolTimingStats* stats, double* rank_sums)
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    GolTimer total[TIMER_COUNT];
+    double sums[TIMER_COUNT];
+    for (int t = 0; t < TIMER_COUNT; t++)
+    {
+        MPI_Reduce(&timers[t].min, &total[t].min, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&timers[t].max, &total[t].max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&timers[t].sum, &total[t].sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&timers[t].count, &total[t].count, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(timers[t].bins, total[t].bins, TIMING_BINS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        sums[t] = timers[t].sum;
+    }
+    MPI_Gather(sums, TIMER_COUNT, MPI_DOUBLE, rank_sums, TIMER_COUNT, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    if (rank != 0)
+    {
+        return;
+    }
+
+    for (int t = 0; t < TIMER_COUNT; t++)
+    {
+        if (total[t].count == 0)
+        {
+            memset(&stats->timers[t], 0, sizeof(stats->timers[t]));
+            continue;
+        }
+        stats->timers[t].min = total[t].min;
+        stats->timers[t].mean = total[t].sum/total[t].count;
+        stats->timers[t].max = total[t].max;
+        stats->timers[t].p99 = Percentile99(&total[t]);
+    }
+    stats->generations = total[TIMER_GENERATION].count/p;
+
+    // imbalance: slowest rank's compute over the mean rank's compute
+    double busiest = 0.0, mean = 0.0;
+    for (int r = 0; r < p; r++)
+    {
+        double compute = rank_sums[r*TIMER_COUNT + TIMER_COMPUTE];
+        busiest = compute > busiest ? compute : busiest;
+        mean += compute/p;
+    }
+    stats->imbalance = mean > 0.0 ? busiest/mean : 1.0;
+}
+
+// this rank's mean for one timer, 0 if nothing was timed
+double TimingMean(int timer)
+{
+    return timers[timer].count > 0 ? timers[timer].sum/timers[timer].count : 0.0;
+}
+
+// this rank's running total for one timer
+double TimingSum(int timer)
+{
+    return timers[timer].sum;
+}
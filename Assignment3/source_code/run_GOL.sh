@@ -1,4 +1,8 @@
 #!/bin/sh
 
-mpicc -o game_of_life game_of_life.c
-sbatch -N 2 -n $3 sub_GOL.sh $1 $2
\ No newline at end of file
+mpicc -O2 -fopenmp -o game_of_life game_of_life.c gol_grid.c gol_halo.c gol_packed.c gol_simd.c gol_alloc.c gol_hashlife.c gol_tiles.c gol_io.c gol_rule.c gol_timing.c gol_balance.c gol_detect.c gol_shm.c gol_rma.c gol_ltl.c gol_ooc.c -lm
+NUM_ITERATIONS=$1
+BOARD_SIZE=$2
+NUM_PROCS=$3
+shift 3
+sbatch -N 2 -n $NUM_PROCS sub_GOL.sh $NUM_ITERATIONS $BOARD_SIZE "$@"
\ No newline at end of file
@@ -8,6 +8,12 @@
 
 #define __DEBUG__ 0
 
+// most elements per rank in one gather round, so every MPI count fits an int
+#define GATHER_CHUNK (1LL << 28)
+
+// modulus the affine maps are composed under; the same on every rank
+long long modulus = 1;
+
 // multiply M1 x M2 while mod the inner product by P
 int** modified_matrix_multiply(int** M1, int** M2, int M1_rows, int M1_cols, int M2_rows, int M2_cols, int P)
 {
@@ -22,10 +28,11 @@ int** modified_matrix_multiply(int** M1, int** M2, int M1_rows, int M1_cols, int
     {
         for (int j = 0; j < M2_cols; j++)
         {
-            int sum = 0;
+            // 64-bit products, so any P below 2^31 is exact
+            long long sum = 0;
             for (int k = 0; k < M1_cols; k++)
             {
-                sum += M1[i][k]*M2[k][j];
+                sum += (long long)M1[i][k]*M2[k][j]%P;
             }
             result[i][j] = sum%P;
         }
@@ -34,6 +41,94 @@ int** modified_matrix_multiply(int** M1, int** M2, int M1_rows, int M1_cols, int
     return result;
 }
 
+void free_matrix(int** M, int rows)
+{
+    for (int i = 0; i < rows; i++)
+    {
+        free(M[i]);
+    }
+    free(M);
+}
+
+// compute M^k (2x2) mod P by repeated squaring: O(log k) multiplies instead of k
+int** modified_matrix_power(int** M, long long k, int P)
+{
+    int** result = (int**)malloc(sizeof(int*)*2);
+    int** base = (int**)malloc(sizeof(int*)*2);
+    for (int i = 0; i < 2; i++)
+    {
+        result[i] = (int*)malloc(sizeof(int)*2);
+        base[i] = (int*)malloc(sizeof(int)*2);
+        for (int j = 0; j < 2; j++)
+        {
+            result[i][j] = (i == j) % P;
+            base[i][j] = M[i][j];
+        }
+    }
+
+    // result picks up base = M^(2^b) for every set bit b of k
+    while (k > 0)
+    {
+        int** next;
+        if (k & 1)
+        {
+            next = modified_matrix_multiply(result, base, 2, 2, 2, 2, P);
+            free_matrix(result, 2);
+            result = next;
+        }
+        k >>= 1;
+        if (k > 0)
+        {
+            next = modified_matrix_multiply(base, base, 2, 2, 2, 2, P);
+            free_matrix(base, 2);
+            base = next;
+        }
+    }
+    free_matrix(base, 2);
+
+    return result;
+}
+
+// state x_i of the generator started from seed, for any index i, in O(log i)
+int rng_state_at(int A, int B, int P, int seed, long long i)
+{
+    int** M1 = (int**)malloc(sizeof(int*)*2);
+    for (int r = 0; r < 2; r++)
+    {
+        M1[r] = (int*)malloc(sizeof(int)*2);
+    }
+    M1[0][0] = A%P;
+    M1[0][1] = 0;
+    M1[1][0] = B%P;
+    M1[1][1] = 1%P;
+
+    // [x_i, 1] = [seed, 1] x M^i
+    int** Mi = modified_matrix_power(M1, i, P);
+    int x = ((long long)seed*Mi[0][0] + Mi[1][0])%P;
+
+    free_matrix(M1, 2);
+    free_matrix(Mi, 2);
+    return x;
+}
+
+
+/*
+    x -> (a*x + b) mod P, stored as {a, b}. For MPI_Exscan, invec holds the
+    maps of the lower ranks, applied first, and inoutvec the higher one, so
+    inoutvec becomes inoutvec(invec(x)).
+*/
+void compose_affine(void* invec, void* inoutvec, int* len, MPI_Datatype* datatype)
+{
+    long long* first = (long long*)invec;
+    long long* then = (long long*)inoutvec;
+    for (int i = 0; i < *len; i++, first += 2, then += 2)
+    {
+        long long a = then[0]*first[0]%modulus;
+        long long b = (then[0]*first[1] + then[1])%modulus;
+        then[0] = a;
+        then[1] = b;
+    }
+}
 
 int main(int argc, char** argv)
 {
@@ -48,30 +143,21 @@ int main(int argc, char** argv)
         return -1;
     }
 
-    int N = atoi(argv[1]);
+    // N may pass 2^31; every rank's block of N/p must not
+    long long N = atoll(argv[1]);
     int A = atoi(argv[2]);
     int B = atoi(argv[3]);
     int P = atoi(argv[4]);
     int seed = atoi(argv[5]);
+    modulus = P;
 
     double start_time, end_time;
     start_time = MPI_Wtime();
 
     // init partial array
-    int* partial_array = (int*)malloc(sizeof(int)*N/p);
-    int iterator = 0;
-
-    // init basis matrixes
-    int** M0 = (int**)malloc(sizeof(int*)*2);
-    for (int i = 0; i < 2; i++)
-    {
-        M0[i] = (int*)malloc(sizeof(int)*2);
-    }
-    M0[0][0] = 1;
-    M0[0][1] = 0;
-    M0[1][0] = 0;
-    M0[1][1] = 1;
+    int* partial_array = (int*)malloc(sizeof(int)*(N/p));
 
+    // init basis matrix
     int** M1 = (int**)malloc(sizeof(int*)*2);
     for (int i = 0; i < 2; i++)
     {
@@ -82,52 +168,65 @@ int main(int argc, char** argv)
     M1[1][0] = B;
     M1[1][1] = 1;
 
-    // compute M(rank * n/p) at each rank
-    int** Mranknp = (int**)malloc(sizeof(int*)*2);
-    for (int i = 0; i < 2; i++)
-    {
-        Mranknp[i] = (int*)malloc(sizeof(int)*2);
-    }
-    for (int i = 0; i <= rank*N/p; i++)
+    // this rank's block advances the generator N/p steps: M(n/p) = [[a, 0], [b, 1]]
+    int** Mnp = modified_matrix_power(M1, N/p, P);
+    long long local_map[2] = {Mnp[0][0], Mnp[1][0]};
+    long long prefix_map[2] = {1, 0};
+
+    // compose the blocks of all lower ranks: M(rank * n/p) in O(log p) steps
+    MPI_Datatype affine_map;
+    MPI_Type_contiguous(2, MPI_LONG_LONG, &affine_map);
+    MPI_Type_commit(&affine_map);
+    MPI_Op compose;
+    MPI_Op_create(compose_affine, 0, &compose);
+    MPI_Exscan(local_map, prefix_map, 1, affine_map, compose, MPI_COMM_WORLD);
+    MPI_Op_free(&compose);
+    MPI_Type_free(&affine_map);
+
+    // rank 0 has no lower ranks, and its Exscan result is undefined
+    if (rank == 0)
     {
-        if (__DEBUG__)
-            printf("proc %d: computing M(%d)\n", rank, i);
-        if (i == 0)
-        {
-            Mranknp = M0;
-        }
-        else
-        {
-            Mranknp = modified_matrix_multiply(Mranknp, M1, 2, 2, 2, 2, P);
-        }
+        prefix_map[0] = 1;
+        prefix_map[1] = 0;
     }
 
     if (__DEBUG__)
     {
-        printf("****Proc %d****\nM(rank * n/p)=[[%d, %d]\n               [%d, %d]]\n", rank, Mranknp[0][0], Mranknp[0][1], Mranknp[1][0], Mranknp[1][1]);
+        printf("****Proc %d****\nM(rank * n/p)=[[%lld, 0]\n               [%lld, 1]]\n", rank, prefix_map[0], prefix_map[1]);
+        printf("proc %d: x(%lld)=%d\n", rank, rank*(N/p), rng_state_at(A, B, P, seed, rank*(N/p)));
     }
 
-    int* prefix_vector = (int*)malloc(sizeof(int)*2);
-    prefix_vector[0] = seed;
-    prefix_vector[1] = 1;
-
-    for (; iterator < N/p; iterator++)
+    // serial recurrence from this rank's starting state; rank 0 starts at seed itself
+    long long x = rank == 0 ? seed : (prefix_map[0]*seed + prefix_map[1])%P;
+    for (long long i = 0; i < N/p; i++)
     {
-        prefix_vector = *(modified_matrix_multiply(&prefix_vector, Mranknp, 1, 2, 2, 2, P));
-        partial_array[iterator] = prefix_vector[0];
-        Mranknp = modified_matrix_multiply(Mranknp, M1, 2, 2, 2, 2, P);
-        prefix_vector[0] = seed;
-        prefix_vector[1] = 1;
+        partial_array[i] = (int)x;
+        x = ((long long)A*x + B)%P;
     }
 
-    // gather partial arrays
-    int* array = (int*)malloc(sizeof(int)*N);
-    MPI_Gather(partial_array, N/p, MPI_INT, array, N/p, MPI_INT, 0, MPI_COMM_WORLD);
+    // gather partial arrays on rank 0 only; blocks longer than GATHER_CHUNK go in
+    // rounds, each landing at the same offset of every rank's block
+    int* array = NULL;
+    if (rank == 0)
+    {
+        array = (int*)malloc(sizeof(int)*(N/p)*p);
+    }
+    for (long long offset = 0; offset < N/p; offset += GATHER_CHUNK)
+    {
+        int length = (int)(N/p - offset < GATHER_CHUNK ? N/p - offset : GATHER_CHUNK);
+        MPI_Datatype piece, block;
+        MPI_Type_contiguous(length, MPI_INT, &piece);
+        MPI_Type_create_resized(piece, 0, (MPI_Aint)(N/p)*sizeof(int), &block);
+        MPI_Type_commit(&block);
+        MPI_Gather(partial_array + offset, length, MPI_INT, rank == 0 ? array + offset : NULL, 1, block, 0, MPI_COMM_WORLD);
+        MPI_Type_free(&piece);
+        MPI_Type_free(&block);
+    }
 
     if (rank == 0 && __DEBUG__)
     {
         printf("Array: ");
-        for (int i = 0; i < N; i++)
+        for (long long i = 0; i < (N/p)*p; i++)
         {
             printf("%d ", array[i]);
         }
@@ -137,15 +236,8 @@ int main(int argc, char** argv)
     // free memory
     free(partial_array);
     free(array);
-    for (int i = 0; i < 2; i++)
-    {
-        free(M0[i]);
-        free(M1[i]);
-        free(Mranknp[i]);
-    }
-    free(M0);
-    free(M1);
-    free(Mranknp);
+    free_matrix(M1, 2);
+    free_matrix(Mnp, 2);
 
     end_time = MPI_Wtime();
     MPI_Allreduce(MPI_IN_PLACE, &end_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);